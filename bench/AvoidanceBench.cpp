@@ -0,0 +1,45 @@
+#include "Bench.h"
+
+#include "Server/Avoidance.h"
+#include "Server/MapInfo.h"
+#include "Server/SoldierBuffers.h"
+#include "Server/SpatialGrid.h"
+
+BENCHMARK("soldier/avoidance") {
+    const float maxSpeed = AvoidanceSettings{}.maxSpeed;
+
+    for (std::size_t count: { 250, 1000, 4000 }) {
+        // two armies walking through each other
+        SoldierBuffers buffers;
+        buffers.resize(count);
+        for (std::size_t i = 0; i < count; i++) {
+            bool left = i < count / 2;
+            std::size_t row = (i % (count / 2)) / 10;
+            std::size_t column = i % 10;
+
+            buffers.x[i] = left ? 40.f * column : 1000.f - 40.f * column;
+            buffers.y[i] = 40.f * row + (left ? 0.f : 20.f);
+            buffers.vx[i] = 0.f;
+            buffers.vy[i] = 0.f;
+            buffers.prefX[i] = left ? maxSpeed : -maxSpeed;
+            buffers.prefY[i] = 0.f;
+            buffers.radius[i] = 16.f;
+        }
+
+        MapInfo mapInfo;
+        mapInfo.init();
+
+        SpatialGrid grid(64.f);
+        AvoidanceSettings settings;
+        settings.budget = std::chrono::seconds(10);
+
+        double ms = Bench::measure([&] {
+            grid.build(buffers.x.data(), buffers.y.data(), count);
+            Avoidance::computeVelocities(buffers, grid, mapInfo, settings, 0.05f,
+                                         std::chrono::steady_clock::now() + settings.budget, 0, count);
+            Bench::doNotOptimize(buffers.nextVx[0]);
+        });
+
+        reporter.report("soldier/avoidance/" + std::to_string(count), count / ms, "soldiers/ms");
+    }
+}
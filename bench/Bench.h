@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Bench {
+class Reporter {
+public:
+    void report(const std::string& name, double value, const std::string& unit);
+};
+
+using Function = std::function<void(Reporter&)>;
+
+struct Benchmark {
+    std::string name;
+    Function function;
+};
+
+std::vector<Benchmark>& benchmarks();
+
+struct Registrar {
+    Registrar(std::string name, Function function) {
+        benchmarks().push_back({ std::move(name), std::move(function) });
+    }
+};
+
+// runs function in batches for at least minSeconds and returns the median milliseconds per call of the batches,
+// so a batch that got descheduled doesn't move the result
+template<typename F>
+double measure(F&& function, double minSeconds = 0.5, std::size_t batches = 7) {
+    using clock = std::chrono::steady_clock;
+
+    // warm up and find how many calls fill one batch
+    std::size_t iterations = 1;
+    for (;;) {
+        auto start = clock::now();
+        for (std::size_t i = 0; i < iterations; i++) function();
+        std::chrono::duration<double> elapsed = clock::now() - start;
+
+        if (elapsed.count() >= minSeconds / static_cast<double>(batches)) break;
+        iterations *= 2;
+    }
+
+    std::vector<double> samples(batches);
+    for (auto& sample: samples) {
+        auto start = clock::now();
+        for (std::size_t i = 0; i < iterations; i++) function();
+        std::chrono::duration<double, std::milli> elapsed = clock::now() - start;
+
+        sample = elapsed.count() / static_cast<double>(iterations);
+    }
+
+    std::nth_element(samples.begin(), samples.begin() + batches / 2, samples.end());
+    return samples[batches / 2];
+}
+
+// keeps the optimiser from throwing away results
+template<typename T>
+void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+}
+
+#define BENCH_CONCAT_INNER(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_INNER(a, b)
+#define BENCHMARK(name) \
+    static void BENCH_CONCAT(benchmark_, __LINE__)(Bench::Reporter&); \
+    static Bench::Registrar BENCH_CONCAT(registrar_, __LINE__)(name, BENCH_CONCAT(benchmark_, __LINE__)); \
+    static void BENCH_CONCAT(benchmark_, __LINE__)(Bench::Reporter& reporter)
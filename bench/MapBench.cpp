@@ -0,0 +1,129 @@
+#include "Bench.h"
+
+#include "NetworkEntityMap.h"
+#include "Server/MapInfo.h"
+#include "Server/NetworkIdAllocator.h"
+#include "Client/WallMask.h"
+
+#include <random>
+
+namespace {
+constexpr std::size_t LOOKUPS = 10000;
+
+// a map with a third of the tiles built on, walls and farms mixed, owned by four players in quadrants
+struct BuiltMap {
+    entt::registry registry;
+    MapInfo mapInfo;
+    std::vector<entt::entity> walls;
+
+    explicit BuiltMap(uint32_t size) {
+        mapInfo.size = size;
+        mapInfo.init();
+
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<int> roll(0, 2);
+
+        for (int y = 0; y < static_cast<int>(size); y++) {
+            for (int x = 0; x < static_cast<int>(size); x++) {
+                if (roll(random) != 0) continue;
+
+                StructureType type = (x + y) % 4 == 0 ? FARM : WALL;
+                ID_t owner = (x < static_cast<int>(size) / 2 ? 0 : 1) + (y < static_cast<int>(size) / 2 ? 0 : 2);
+
+                entt::entity entity = registry.create();
+                registry.emplace<Structure>(entity, Structure{ type, x, y, 1, owner });
+                mapInfo.setStructure(x, y, entity);
+                if (type == WALL) walls.push_back(entity);
+            }
+        }
+
+        for (entt::entity wall: walls) {
+            const auto& structure = registry.get<Structure>(wall);
+            updateWallMasks(mapInfo, registry, structure.x, structure.y);
+        }
+    }
+};
+}
+
+BENCHMARK("map/NetworkEntityMap::get") {
+    for (std::size_t count: { 1000, 100000 }) {
+        entt::registry registry;
+        NetworkEntityMap NEP;
+        NetworkIdAllocator networkIds;
+        NEP.init(registry);
+        networkIds.init(registry);
+
+        std::vector<NetworkID> ids;
+        for (std::size_t i = 0; i < count; i++) {
+            entt::entity entity = registry.create();
+            ids.push_back(registry.emplace<NetworkID>(entity, networkIds.allocate()));
+        }
+
+        // lookups come in whatever order the updates were collected in
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+        std::vector<NetworkID> lookups(LOOKUPS);
+        for (auto& id: lookups) id = ids[pick(random)];
+
+        double ms = Bench::measure([&] {
+            std::size_t found = 0;
+            for (NetworkID id: lookups) found += NEP.get(id) != entt::null;
+            Bench::doNotOptimize(found);
+        });
+        reporter.report("map/NetworkEntityMap::get/" + std::to_string(count), LOOKUPS / ms, "lookups/ms");
+    }
+}
+
+BENCHMARK("map/MapInfo::structureAt") {
+    for (uint32_t size: { 64u, 512u }) {
+        BuiltMap map(size);
+
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<int> coordinate(0, static_cast<int>(size) - 1);
+        std::vector<std::pair<int, int>> lookups(LOOKUPS);
+        for (auto& [x, y]: lookups) {
+            x = coordinate(random);
+            y = coordinate(random);
+        }
+
+        double ms = Bench::measure([&] {
+            std::size_t found = 0;
+            for (auto [x, y]: lookups) found += map.mapInfo.structureAt(x, y) != entt::null;
+            Bench::doNotOptimize(found);
+        });
+        reporter.report("map/MapInfo::structureAt/random/" + std::to_string(size), LOOKUPS / ms, "lookups/ms");
+
+        // the renderer walks the visible tiles row by row
+        ms = Bench::measure([&] {
+            std::size_t found = 0;
+            for (int y = 0; y < static_cast<int>(size); y++)
+                for (int x = 0; x < static_cast<int>(size); x++)
+                    found += map.mapInfo.structureAt(x, y) != entt::null;
+            Bench::doNotOptimize(found);
+        });
+        reporter.report("map/MapInfo::structureAt/scan/" + std::to_string(size), size * size / ms, "tiles/ms");
+    }
+}
+
+BENCHMARK("map/wall_mask") {
+    for (uint32_t size: { 64u, 512u }) {
+        BuiltMap map(size);
+
+        double ms = Bench::measure([&] {
+            unsigned masks = 0;
+            for (entt::entity wall: map.walls) {
+                masks += wallNeighbourMask(map.mapInfo, map.registry, map.registry.get<Structure>(wall));
+            }
+            Bench::doNotOptimize(masks);
+        });
+        reporter.report("map/wall_mask/" + std::to_string(size), map.walls.size() / ms, "walls/ms");
+
+        // what the renderer does now, the mask is only recomputed when a wall next to it changes
+        ms = Bench::measure([&] {
+            unsigned masks = 0;
+            for (entt::entity wall: map.walls) masks += map.registry.get<WallMask>(wall).mask;
+            Bench::doNotOptimize(masks);
+        });
+        reporter.report("map/wall_mask/cached/" + std::to_string(size), map.walls.size() / ms, "walls/ms");
+    }
+}
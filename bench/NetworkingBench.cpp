@@ -0,0 +1,121 @@
+#include "Bench.h"
+
+#include "Packets.h"
+#include "Networking/SocketServer.h"
+
+#include <random>
+
+namespace {
+// a tick worth of replication, mostly soldiers moving and a few farms and new structures
+std::vector<EntityUpdate> makeUpdates(std::size_t count) {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(0.f, 4096.f);
+
+    std::vector<EntityUpdate> updates(count);
+    for (std::size_t i = 0; i < count; i++) {
+        auto& update = updates[i];
+        update.id = NetworkID(static_cast<uint32_t>(i), 0);
+
+        switch (i % 10) {
+            case 0:
+                update.flags = UPDATE_STRUCTURE_CREATED;
+                update.structure = Structure{ WALL, static_cast<int>(i % 128), static_cast<int>(i / 128), 1, 1 };
+                break;
+            case 1:
+                update.flags = UPDATE_FARM;
+                break;
+            default:
+                update.flags = UPDATE_POSITION;
+                update.position = Position{ position(random), position(random) };
+                break;
+        }
+    }
+
+    return updates;
+}
+}
+
+BENCHMARK("network/createPacket") {
+    double ms = Bench::measure([] {
+        sf::Packet packet = Networking::createPacket<C2S_PLACE_WALL_PACKET>(12, 34);
+        Bench::doNotOptimize(packet.getDataSize());
+    });
+    reporter.report("network/createPacket/place_wall", 1.0 / ms, "packets/ms");
+
+    for (std::size_t count: { 100, 1000, 10000 }) {
+        std::vector<EntityUpdate> updates = makeUpdates(count);
+
+        ms = Bench::measure([&] {
+            sf::Packet packet = Networking::createPacket<S2C_ENTITY_UPDATES_PACKET>(updates);
+            Bench::doNotOptimize(packet.getDataSize());
+        });
+        reporter.report("network/createPacket/entity_updates/" + std::to_string(count), count / ms, "updates/ms");
+    }
+}
+
+BENCHMARK("network/packetReader") {
+    for (std::size_t count: { 100, 1000, 10000 }) {
+        const sf::Packet packet = Networking::createPacket<S2C_ENTITY_UPDATES_PACKET>(makeUpdates(count));
+
+        // every read consumes its packet, so the copy is part of what is measured
+        double ms = Bench::measure([&] {
+            sf::Packet copy = packet;
+            Networking::getPacketType(copy);
+            auto updates = Networking::packetReader<std::vector<EntityUpdate>>(copy);
+            Bench::doNotOptimize(updates.size());
+        });
+        reporter.report("network/packetReader/entity_updates/" + std::to_string(count), count / ms, "updates/ms");
+    }
+}
+
+BENCHMARK("network/overloads") {
+    std::vector<uint32_t> chunks(4096);
+    for (std::size_t i = 0; i < chunks.size(); i++) chunks[i] = static_cast<uint32_t>(i);
+
+    double ms = Bench::measure([&] {
+        sf::Packet packet;
+        packet << chunks;
+
+        std::vector<uint32_t> read;
+        packet >> read;
+        Bench::doNotOptimize(read.size());
+    });
+    reporter.report("network/overloads/vector_u32", chunks.size() / ms, "elements/ms");
+
+    std::unordered_map<ID_t, ServerPlayerInfo> players;
+    for (ID_t id = 0; id < 64; id++) {
+        players.emplace(id, ServerPlayerInfo{ .name = "player" + std::to_string(id), .id = id, .ready = true });
+    }
+
+    ms = Bench::measure([&] {
+        sf::Packet packet;
+        packet << players;
+
+        std::unordered_map<ID_t, ServerPlayerInfo> read;
+        packet >> read;
+        Bench::doNotOptimize(read.size());
+    });
+    reporter.report("network/overloads/unordered_map_players", players.size() / ms, "elements/ms");
+}
+
+BENCHMARK("network/dispatch") {
+    constexpr std::size_t PACKETS = 1000;
+
+    Networking::SocketServer server(sf::IpAddress::LocalHost, 0);
+    server.startHeadless();
+
+    int placed = 0;
+    server.addReceiveCallback(C2S_PLACE_WALL_PACKET, std::function<void(ID_t, int, int)>([&](ID_t, int x, int y) {
+        placed += x + y;
+    }));
+
+    const sf::Packet packet = Networking::createPacket<C2S_PLACE_WALL_PACKET>(12, 34);
+
+    // injected packets take the same dispatch path as ones received from sockets
+    double ms = Bench::measure([&] {
+        for (std::size_t i = 0; i < PACKETS; i++) server.injectPacket(static_cast<ID_t>(i % 8), packet);
+        server.handleCallbacks();
+        Bench::doNotOptimize(placed);
+    });
+    reporter.report("network/dispatch/place_wall", PACKETS / ms, "packets/ms");
+}
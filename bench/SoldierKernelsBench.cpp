@@ -0,0 +1,73 @@
+#include "Bench.h"
+
+#include "Server/SoldierBuffers.h"
+#include "Server/SoldierKernels.h"
+
+#include <random>
+
+namespace {
+SoldierBuffers makeSoldiers(std::size_t count) {
+    SoldierBuffers buffers;
+    buffers.resize(count);
+
+    // roughly one soldier per tile so there is a realistic amount of overlap
+    std::mt19937 random(1234);
+    float side = std::sqrt(static_cast<float>(count)) * 32.f;
+    std::uniform_real_distribution<float> position(0.f, side);
+    std::uniform_real_distribution<float> direction(-1.f, 1.f);
+
+    for (std::size_t i = 0; i < count; i++) {
+        buffers.entities[i] = static_cast<entt::entity>(i);
+        buffers.x[i] = position(random);
+        buffers.y[i] = position(random);
+        buffers.vx[i] = 0.f;
+        buffers.vy[i] = 0.f;
+        buffers.prefX[i] = direction(random);
+        buffers.prefY[i] = direction(random);
+        buffers.radius[i] = 16.f;
+    }
+
+    return buffers;
+}
+}
+
+BENCHMARK("soldier/normalize+integrate") {
+    for (std::size_t count: { 1000, 10000, 100000 }) {
+        SoldierBuffers buffers = makeSoldiers(count);
+
+        double ms = Bench::measure([&] {
+            SoldierKernels::normalize(buffers.prefX.data(), buffers.prefY.data(), count);
+            SoldierKernels::integrate(buffers.x.data(), buffers.y.data(), buffers.prefX.data(), buffers.prefY.data(),
+                                      0.05f, count);
+            Bench::doNotOptimize(buffers.x[0]);
+        });
+
+        reporter.report("soldier/normalize+integrate/" + std::to_string(count) + "/" +
+                        SoldierKernels::instructionSet(), count / ms, "soldiers/ms");
+    }
+}
+
+BENCHMARK("soldier/separation") {
+    constexpr std::size_t SOLDIERS = 1000;
+
+    // every soldier against a grid query's worth of neighbours, what the avoidance fallback runs
+    for (std::size_t neighbours: { 16, 64, 256 }) {
+        SoldierBuffers buffers = makeSoldiers(neighbours);
+
+        double ms = Bench::measure([&] {
+            float forceX = 0.f;
+            float forceY = 0.f;
+            for (std::size_t i = 0; i < SOLDIERS; i++) {
+                std::size_t self = i % neighbours;
+                SoldierKernels::separation(buffers.x[self], buffers.y[self], buffers.radius[self],
+                                           buffers.x.data(), buffers.y.data(), buffers.radius.data(), neighbours,
+                                           forceX, forceY);
+            }
+            Bench::doNotOptimize(forceX);
+            Bench::doNotOptimize(forceY);
+        });
+
+        reporter.report("soldier/separation/" + std::to_string(neighbours) + "/" + SoldierKernels::instructionSet(),
+                        SOLDIERS / ms, "soldiers/ms");
+    }
+}
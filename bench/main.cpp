@@ -0,0 +1,32 @@
+#include "Bench.h"
+#include "Packets.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace Bench {
+std::vector<Benchmark>& benchmarks() {
+    static std::vector<Benchmark> s_Benchmarks;
+    return s_Benchmarks;
+}
+
+void Reporter::report(const std::string& name, double value, const std::string& unit) {
+    std::printf("%-48s %14.3f %s\n", name.c_str(), value, unit.c_str());
+    std::fflush(stdout);
+}
+}
+
+// LuntikBench [filter], runs every benchmark whose name contains filter
+int main(int argc, char *argv[]) {
+    registerPackets();
+
+    const char *filter = argc > 1 ? argv[1] : "";
+
+    Bench::Reporter reporter;
+    for (const auto& benchmark: Bench::benchmarks()) {
+        if (benchmark.name.find(filter) == std::string::npos) continue;
+        benchmark.function(reporter);
+    }
+
+    return 0;
+}
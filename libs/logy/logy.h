@@ -170,14 +170,29 @@ static inline void _Silent2(T... args) {
     logy_helper(std::forward<T>(args)...);
 }
 
+#if defined(LOGY_ASYNC)
+
+#include "logy_async.h"
+#define LOGY_DEBUG2(...) LOGY_ASYNC_LOG(" DEBUG:", __VA_ARGS__)
+#define LOGY_INFO2(...) LOGY_ASYNC_LOG(" INFO:", __VA_ARGS__)
+#define LOGY_WARNING2(...) LOGY_ASYNC_LOG(" WARNING:", __VA_ARGS__)
+
+#else
+
+#define LOGY_DEBUG2(...) _Debug2(__VA_ARGS__)
+#define LOGY_INFO2(...) _Info2(__VA_ARGS__)
+#define LOGY_WARNING2(...) _Warning2(__VA_ARGS__)
+
+#endif
+
 #if defined(DEBUG) || defined(LOGGING_DEBUG)
 
 #define Debug(...) _Debug(__VA_ARGS__)
 #define Info(...) _Info(__VA_ARGS__)
 #define Warning(...) _Warning(__VA_ARGS__)
-#define LOG_DEBUG(...) _Debug2(__VA_ARGS__)
-#define LOG_INFO(...) _Info2(__VA_ARGS__)
-#define LOG_WARNING(...) _Warning2(__VA_ARGS__)
+#define LOG_DEBUG(...) LOGY_DEBUG2(__VA_ARGS__)
+#define LOG_INFO(...) LOGY_INFO2(__VA_ARGS__)
+#define LOG_WARNING(...) LOGY_WARNING2(__VA_ARGS__)
 
 #elif defined(VERBOSE) || defined(LOGGING_VERBOSE)
 
@@ -185,8 +200,8 @@ static inline void _Silent2(T... args) {
 #define Info(...) _Info(__VA_ARGS__)
 #define Warning(...) _Warning(__VA_ARGS__)
 #define LOG_DEBUG(...) ((void)0)
-#define LOG_INFO(...) _Info2(__VA_ARGS__)
-#define LOG_WARNING(...) _Warning2(__VA_ARGS__)
+#define LOG_INFO(...) LOGY_INFO2(__VA_ARGS__)
+#define LOG_WARNING(...) LOGY_WARNING2(__VA_ARGS__)
 
 #else
 
@@ -195,7 +210,7 @@ static inline void _Silent2(T... args) {
 #define Warning(...) _Warning(__VA_ARGS__)
 #define LOG_DEBUG(...) ((void)0)
 #define LOG_INFO(...) ((void)0)
-#define LOG_WARNING(...) _Warning2(__VA_ARGS__)
+#define LOG_WARNING(...) LOGY_WARNING2(__VA_ARGS__)
 
 #endif
 
@@ -0,0 +1,349 @@
+// -*- mode: c++ -*-
+
+// asynchronous backend for the LOG_ macros, enabled with LOGY_ASYNC
+//
+// the calling thread only copies the arguments into its own ring buffer, a background thread formats and writes
+// them to stderr. every call site is rate limited, a site that logs more than LOGY_SITE_BURST messages in a
+// second is muted for the rest of that second and reports how many messages it swallowed once it speaks again.
+// a full ring drops the message instead of blocking, the drops are reported by the background thread
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifndef LOGY_SITE_BURST
+#define LOGY_SITE_BURST 20
+#endif
+
+namespace logy_async {
+
+constexpr std::size_t SLOT_COUNT = 1024;
+constexpr std::size_t SLOT_PAYLOAD = 224;
+constexpr auto DRAIN_INTERVAL = std::chrono::milliseconds(10);
+
+// appends one argument to out and advances cursor past it
+using format_fn = void (*)(std::string& out, const char *& cursor);
+
+struct slot {
+    uint64_t seq;
+    std::time_t time;
+    const char *tag;
+    uint16_t size;
+    bool truncated;
+    char payload[SLOT_PAYLOAD];
+};
+
+// single producer, the owning thread, and a single consumer, the background thread
+struct ring {
+    slot slots[SLOT_COUNT];
+    std::atomic<uint64_t> head{ 0 };
+    std::atomic<uint64_t> tail{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+    // the owning thread exited, freed once drained
+    std::atomic<bool> retired{ false };
+};
+
+struct site {
+    const char *file;
+    int line;
+    std::atomic<int64_t> window{ -1 };
+    std::atomic<uint32_t> count{ 0 };
+    std::atomic<uint32_t> suppressed{ 0 };
+
+    constexpr site(const char *file, int line) : file(file), line(line) {}
+
+    // suppressedBefore is set to what the site swallowed in earlier windows, once the new window opens
+    bool allow(uint32_t& suppressedBefore) {
+        int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        int64_t current = window.load(std::memory_order_relaxed);
+        if (current != now && window.compare_exchange_strong(current, now, std::memory_order_relaxed)) {
+            count.store(0, std::memory_order_relaxed);
+            suppressedBefore = suppressed.exchange(0, std::memory_order_relaxed);
+        }
+
+        if (count.fetch_add(1, std::memory_order_relaxed) < LOGY_SITE_BURST) return true;
+
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+};
+
+class backend {
+public:
+    backend() : m_thread(&backend::run, this) {}
+
+    ~backend() {
+        // anything logged from here on is written directly, the final drain below picks up the rest
+        stopped().store(true, std::memory_order_release);
+        m_stop.store(true, std::memory_order_relaxed);
+        m_thread.join();
+
+        // threads that outlive us still retire their ring when they exit, so the rings are leaked instead of freed
+        for (auto& r: m_rings) r.release();
+    }
+
+    static std::atomic<bool>& stopped() {
+        static std::atomic<bool> s_stopped{ false };
+        return s_stopped;
+    }
+
+    ring *add_ring() {
+        std::lock_guard<std::mutex> guard(m_rings_mutex);
+        m_rings.push_back(std::make_unique<ring>());
+        return m_rings.back().get();
+    }
+
+    uint64_t next_seq() {
+        return m_seq.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    struct line {
+        uint64_t seq;
+        std::string text;
+    };
+
+    void run() {
+        for (;;) {
+            bool stop = m_stop.load(std::memory_order_relaxed);
+            drain();
+            if (stop) return;
+            std::this_thread::sleep_for(DRAIN_INTERVAL);
+        }
+    }
+
+    void drain() {
+        m_lines.clear();
+        uint64_t dropped = 0;
+
+        {
+            std::lock_guard<std::mutex> guard(m_rings_mutex);
+            for (auto& r: m_rings) {
+                uint64_t tail = r->tail.load(std::memory_order_relaxed);
+                uint64_t head = r->head.load(std::memory_order_acquire);
+
+                for (; tail < head; tail++) {
+                    const slot& s = r->slots[tail % SLOT_COUNT];
+                    m_lines.push_back({ s.seq, format(s) });
+                }
+
+                r->tail.store(tail, std::memory_order_release);
+                dropped += r->dropped.exchange(0, std::memory_order_relaxed);
+            }
+
+            m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), [](const std::unique_ptr<ring>& r) {
+                return r->retired.load(std::memory_order_acquire) &&
+                       r->tail.load(std::memory_order_relaxed) == r->head.load(std::memory_order_acquire);
+            }), m_rings.end());
+        }
+
+        if (m_lines.empty() && dropped == 0) return;
+
+        // every thread has its own ring, the sequence number puts them back in the order they were logged
+        std::sort(m_lines.begin(), m_lines.end(), [](const line& a, const line& b) { return a.seq < b.seq; });
+
+        m_out.clear();
+        for (const auto& l: m_lines) m_out += l.text;
+        if (dropped > 0) {
+            m_out += timestamp(std::time(nullptr)) + " WARNING: " + std::to_string(dropped) +
+                     " log messages dropped, the log buffer was full\n";
+        }
+
+        std::fwrite(m_out.data(), 1, m_out.size(), stderr);
+        std::fflush(stderr);
+    }
+
+    static std::string timestamp(std::time_t time) {
+        char buffer[100] = "";
+        std::strftime(buffer, sizeof(buffer), "[%H:%M:%S]", std::localtime(&time));
+        return buffer;
+    }
+
+    static std::string format(const slot& s) {
+        std::string text = timestamp(s.time) + s.tag;
+
+        const char *cursor = s.payload;
+        const char *end = s.payload + s.size;
+        while (cursor < end) {
+            format_fn fn;
+            std::memcpy(&fn, cursor, sizeof(fn));
+            cursor += sizeof(fn);
+
+            text += ' ';
+            fn(text, cursor);
+        }
+
+        if (s.truncated) text += " ...";
+        text += '\n';
+        return text;
+    }
+
+    std::atomic<bool> m_stop{ false };
+    std::atomic<uint64_t> m_seq{ 0 };
+
+    std::mutex m_rings_mutex;
+    std::vector<std::unique_ptr<ring>> m_rings;
+
+    std::vector<line> m_lines;
+    std::string m_out;
+
+    // last so everything above exists before the thread starts
+    std::thread m_thread;
+};
+
+inline backend& get_backend() {
+    static backend s_backend;
+    return s_backend;
+}
+
+// retires the ring when its thread exits
+struct ring_owner {
+    ring *r;
+
+    ~ring_owner() {
+        r->retired.store(true, std::memory_order_release);
+    }
+};
+
+inline ring& thread_ring() {
+    thread_local ring_owner owner{ get_backend().add_ring() };
+    return *owner.r;
+}
+
+// encoding, each argument is a format_fn followed by its data
+
+struct writer {
+    char *cursor;
+    char *end;
+    bool truncated = false;
+
+    bool fits(std::size_t size) const {
+        return static_cast<std::size_t>(end - cursor) >= size;
+    }
+
+    void put(const void *data, std::size_t size) {
+        std::memcpy(cursor, data, size);
+        cursor += size;
+    }
+};
+
+template<typename T>
+void format_value(std::string& out, const char *& cursor) {
+    alignas(T) unsigned char storage[sizeof(T)];
+    std::memcpy(storage, cursor, sizeof(T));
+    cursor += sizeof(T);
+    out += tag_expand(*std::launder(reinterpret_cast<const T *>(storage)));
+}
+
+inline void format_string(std::string& out, const char *& cursor) {
+    uint16_t size;
+    std::memcpy(&size, cursor, sizeof(size));
+    cursor += sizeof(size);
+    out.append(cursor, size);
+    cursor += size;
+}
+
+inline void encode_string(writer& w, std::string_view text) {
+    format_fn fn = &format_string;
+    if (!w.fits(sizeof(fn) + sizeof(uint16_t))) {
+        w.truncated = true;
+        return;
+    }
+
+    std::size_t room = static_cast<std::size_t>(w.end - w.cursor) - sizeof(fn) - sizeof(uint16_t);
+    if (text.size() > room) {
+        text = text.substr(0, room);
+        w.truncated = true;
+    }
+
+    auto size = static_cast<uint16_t>(text.size());
+    w.put(&fn, sizeof(fn));
+    w.put(&size, sizeof(size));
+    w.put(text.data(), text.size());
+}
+
+template<typename T>
+void encode(writer& w, const T& arg) {
+    using D = std::decay_t<T>;
+
+    if (w.truncated) return;
+
+    if constexpr (std::is_same_v<D, const char *> || std::is_same_v<D, char *>) {
+        encode_string(w, arg ? std::string_view(arg) : std::string_view("(null)"));
+    } else if constexpr (std::is_same_v<D, std::string> || std::is_same_v<D, std::string_view>) {
+        encode_string(w, arg);
+    } else if constexpr (std::is_trivially_copyable_v<D> && sizeof(D) <= 32) {
+        // numbers, enums, ids and the like are copied as they are and formatted later
+        format_fn fn = &format_value<D>;
+        if (!w.fits(sizeof(fn) + sizeof(D))) {
+            w.truncated = true;
+            return;
+        }
+
+        w.put(&fn, sizeof(fn));
+        w.put(&arg, sizeof(D));
+    } else {
+        // anything owning memory is formatted right away
+        encode_string(w, tag_expand(arg));
+    }
+}
+
+template<typename... T>
+void write(const char *tag, const T&... args) {
+    if (backend::stopped().load(std::memory_order_acquire)) {
+        logy_header(tag);
+        logy_helper(args...);
+        return;
+    }
+
+    ring& r = thread_ring();
+    uint64_t head = r.head.load(std::memory_order_relaxed);
+    if (head - r.tail.load(std::memory_order_acquire) >= SLOT_COUNT) {
+        r.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    slot& s = r.slots[head % SLOT_COUNT];
+    s.seq = get_backend().next_seq();
+    s.time = std::time(nullptr);
+    s.tag = tag;
+
+    writer w{ s.payload, s.payload + SLOT_PAYLOAD };
+    (encode(w, args), ...);
+    s.size = static_cast<uint16_t>(w.cursor - s.payload);
+    s.truncated = w.truncated;
+
+    r.head.store(head + 1, std::memory_order_release);
+}
+
+template<typename... T>
+void log(site& call_site, const char *tag, const T&... args) {
+    uint32_t suppressed = 0;
+    bool allowed = call_site.allow(suppressed);
+
+    if (suppressed > 0) {
+        write(tag, "suppressed", suppressed, "messages from", call_site.file, ":", call_site.line);
+    }
+
+    if (allowed) write(tag, args...);
+}
+}
+
+#define LOGY_ASYNC_LOG(tag, ...) do { \
+        static logy_async::site logy_site_{ __FILE__, __LINE__ }; \
+        logy_async::log(logy_site_, tag, __VA_ARGS__); \
+    } while (0)
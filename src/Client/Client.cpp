@@ -1,24 +1,36 @@
 #include "Client.h"
 
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
 #include <utility>
 #include "Utils/Timers.h"
+#include "Utils/Profiler.h"
 #include "Packets.h"
 #include "ClientGameState.h"
 #include "NetworkEntityMap.h"
-#include "Renderer/YSort.h"
 #include "Server/Position.h"
 #include "InterpolatedPosition.h"
 #include "Server/Hitbox.h"
 
+namespace {
+void styleShopCell(UI::Box& cell, bool hovered) {
+    cell.setFill(sf::Color(0, 0, 0, hovered ? 50 : 20));
+    cell.setOutline(sf::Color::Black, hovered ? 5.f : 3.f);
+}
+}
+
 Client::Client(sf::IpAddress ip, uint16_t port, std::string name) : m_Ip(ip), m_Port(port),
                                                                     m_SocketClient(ip, port),
                                                                     m_Renderer("Luntik Farm"), m_Name(std::move(name)),
-                                                                    m_GameState(), m_Map(&m_GameState.mapInfo) {
+                                                                    m_GameState() {
     m_IsRunning = false;
 }
 
 Client::~Client() {
     if (m_IsRunning) stop();
+    if (m_NetworkThread.joinable()) m_NetworkThread.join();
 }
 
 void Client::start() {
@@ -28,10 +40,6 @@ void Client::start() {
         return;
     }
 
-    if (!m_ShopTexture.loadFromFile("assets/shop.png")) {
-        LOG_WARNING("Failed to load shop texture");
-    }
-
     m_GameState.NEP.init(m_GameState.registry);
 
     m_GameState.registry.on_construct<Structure>().connect<&Client::onCreateStructure>(this);
@@ -46,6 +54,7 @@ void Client::start() {
             S2C_PLAYER_PACKET,
             std::function<void(ID_t, ServerPlayerInfo)>([this](ID_t id, const ServerPlayerInfo& info) {
                 m_GameState.players.insert_or_assign(id, info);
+                ++m_GameState.playersRevision;
                 LOG_INFO("Added to lobby:", m_GameState.players[id].name);
             })
     );
@@ -54,6 +63,7 @@ void Client::start() {
             S2C_PLAYER_QUIT_PACKET,
             std::function<void(ID_t)>([this](ID_t id) {
                 m_GameState.players.erase(id);
+                ++m_GameState.playersRevision;
                 LOG_INFO("Removed from lobby:", id);
             })
     );
@@ -63,6 +73,7 @@ void Client::start() {
             std::function<void(std::unordered_map<ID_t, ServerPlayerInfo>)>(
                     [this](std::unordered_map<ID_t, ServerPlayerInfo> lobby) {
                         m_GameState.players = std::move(lobby);
+                        ++m_GameState.playersRevision;
                         LOG_INFO("Set lobby");
                     })
     );
@@ -71,18 +82,27 @@ void Client::start() {
             S2C_READY_PACKET,
             std::function<void(ID_t, bool)>([this](ID_t id, bool ready) {
                 m_GameState.players[id].ready = ready;
+                ++m_GameState.playersRevision;
                 LOG_INFO("Set ready:", ready);
             })
     );
 
     m_SocketClient.addReceiveCallback(
             S2C_START_GAME_PACKET,
-            std::function<void()>([this]() {
-                m_GameState.gameStage = GameStage::GAME;
-                m_GameState.mapInfo.size = 32;
-                m_GameState.mapInfo.init();
-                LOG_INFO("Game started");
-            })
+            std::function<void(uint32_t, std::vector<EntityUpdate>)>(
+                    [this](uint32_t mapSize, const std::vector<EntityUpdate>& world) {
+                        m_GameState.gameStage = GameStage::GAME;
+                        m_GameState.mapInfo.size = mapSize;
+                        m_GameState.mapInfo.init();
+
+                        for (const auto& update: world) {
+                            applyEntityUpdate(update);
+                        }
+                        // kept in case the server starts a lockstep simulation from it
+                        m_StartWorld = world;
+
+                        LOG_INFO("Game started");
+                    })
     );
 
     m_SocketClient.addReceiveCallback(
@@ -93,53 +113,37 @@ void Client::start() {
     );
 
     m_SocketClient.addReceiveCallback(
-            S2C_STRUCTURE_PACKET,
-            std::function<void(NetworkID, Structure)>([this](NetworkID id, Structure structure) {
-                auto structureEntity = m_GameState.registry.create();
-                m_GameState.registry.emplace<NetworkID>(structureEntity, id.id);
-                m_GameState.registry.emplace<Structure>(structureEntity, structure);
-                m_GameState.registry
-                        .emplace<YSort>(structureEntity, 32 * (structure.y + structure.size));
-            })
-    );
-
-    m_SocketClient.addReceiveCallback(
-            S2C_STRUCTURE_DELETE_PACKET,
-            std::function<void(NetworkID)>([this](NetworkID id) {
-                m_GameState.registry.destroy(m_GameState.NEP.get(id.id));
-            })
-    );
-
-    m_SocketClient.addReceiveCallback(
-            S2C_FARM_PACKET,
-            std::function<void(NetworkID, Farm)>([this](NetworkID id, Farm farm) {
-                m_GameState.registry.emplace_or_replace<Farm>(m_GameState.NEP.get(id.id), farm);
+            S2C_ENTITY_UPDATES_PACKET,
+            std::function<void(std::vector<EntityUpdate>)>([this](const std::vector<EntityUpdate>& updates) {
+                for (const auto& update: updates) {
+                    applyEntityUpdate(update);
+                }
             })
     );
 
     m_SocketClient.addReceiveCallback(
-            S2C_SOLDIER_CREATE_PACKET,
-            std::function<void(NetworkID, Soldier, Position)>([this](NetworkID id, Soldier soldier, Position pos) {
-                auto soldierEntity = m_GameState.registry.create();
-                m_GameState.registry.emplace<NetworkID>(soldierEntity, id.id);
-                m_GameState.registry.emplace<Soldier>(soldierEntity, soldier);
-                m_GameState.registry.emplace<InterpolatedPosition>(soldierEntity, pos.x, pos.y, 0.15f);
-                m_GameState.registry.emplace<YSort>(soldierEntity, pos.y);
-                m_GameState.registry.emplace<Hitbox>(soldierEntity, Hitbox(soldier.size, soldier.size / 2.f));
+            S2C_CHUNK_UNLOAD_PACKET,
+            std::function<void(std::vector<uint32_t>)>([this](const std::vector<uint32_t>& chunks) {
+                for (uint32_t chunk: chunks) {
+                    unloadChunk(chunk);
+                }
             })
     );
 
     m_SocketClient.addReceiveCallback(
-            S2C_SOLDIER_DELETE_PACKET,
-            std::function<void(NetworkID)>([this](NetworkID id) {
-                m_GameState.registry.destroy(m_GameState.NEP.get(id.id));
+            S2C_LOCKSTEP_START_PACKET,
+            std::function<void(std::vector<ID_t>, int)>([this](const std::vector<ID_t>& players, int startingGold) {
+                m_Simulation.init(m_GameState.registry, m_GameState.mapInfo, m_GameState.NEP, m_StartWorld, players,
+                                  startingGold);
+                m_StartWorld.clear();
+                m_Lockstep = true;
             })
     );
 
     m_SocketClient.addReceiveCallback(
-            S2C_SOLDIER_POSITION_PACKET,
-            std::function<void(NetworkID, Position)>([this](NetworkID id, Position pos) {
-                m_GameState.registry.get<InterpolatedPosition>(m_GameState.NEP.get(id.id)).set(pos.x, pos.y);
+            S2C_COMMAND_FRAME_PACKET,
+            std::function<void(uint32_t, std::vector<Command>)>([this](uint32_t tick, std::vector<Command> commands) {
+                m_CommandFrames.emplace_back(tick, std::move(commands));
             })
     );
 
@@ -153,24 +157,295 @@ void Client::start() {
     LOG_INFO("Client started");
 }
 
+void Client::applyEntityUpdate(const EntityUpdate& update) {
+    auto& registry = m_GameState.registry;
+
+    if (update.flags & UPDATE_DELETED) {
+        entt::entity entity = m_GameState.NEP.get(update.id);
+        if (entity == entt::null) {
+            LOG_WARNING("Tried to delete unknown entity", update.id.id);
+            return;
+        }
+
+        registry.destroy(entity);
+        return;
+    }
+
+    // a chunk coming into view can resend a structure that is already known
+    if ((update.flags & UPDATE_STRUCTURE_CREATED) && !m_GameState.NEP.contains(update.id)) {
+        auto structureEntity = registry.create();
+        registry.emplace<NetworkID>(structureEntity, update.id);
+        registry.emplace<Structure>(structureEntity, update.structure);
+    }
+
+    if (update.flags & UPDATE_SOLDIER_CREATED) {
+        const Position& pos = update.position;
+
+        auto soldierEntity = registry.create();
+        registry.emplace<NetworkID>(soldierEntity, update.id);
+        registry.emplace<Soldier>(soldierEntity, update.soldier);
+        registry.emplace<InterpolatedPosition>(soldierEntity, pos.x, pos.y, 0.15f, now());
+        registry.emplace<Hitbox>(soldierEntity, Hitbox(update.soldier.size, update.soldier.size / 2.f));
+    }
+
+    entt::entity entity = m_GameState.NEP.get(update.id);
+    if (entity == entt::null) {
+        LOG_WARNING("Received update for unknown entity", update.id.id);
+        return;
+    }
+
+    if ((update.flags & UPDATE_POSITION) && !(update.flags & UPDATE_SOLDIER_CREATED)) {
+        auto *position = registry.try_get<InterpolatedPosition>(entity);
+        if (position) position->set(update.position.x, update.position.y, now());
+    }
+
+    if (update.flags & UPDATE_FARM) {
+        registry.emplace_or_replace<Farm>(entity, update.farm);
+    }
+}
+
+void Client::unloadChunk(uint32_t chunk) {
+    auto& registry = m_GameState.registry;
+    const auto& mapInfo = m_GameState.mapInfo;
+
+    const MapChunk *mapChunk = mapInfo.chunk(chunk);
+    if (!mapChunk) return;
+
+    int originX = static_cast<int>(chunk % mapInfo.chunksPerSide()) * MAP_CHUNK_SIZE;
+    int originY = static_cast<int>(chunk / mapInfo.chunksPerSide()) * MAP_CHUNK_SIZE;
+
+    // destroying a structure frees the chunk once it's empty, so collect first
+    std::vector<entt::entity> unloaded;
+    for (int i = 0; i < MAP_CHUNK_SIZE * MAP_CHUNK_SIZE; i++) {
+        entt::entity entity = mapChunk->structures[i];
+        if (entity == entt::null) continue;
+
+        const auto& structure = registry.get<Structure>(entity);
+        if (structure.x == originX + i % MAP_CHUNK_SIZE && structure.y == originY + i / MAP_CHUNK_SIZE) {
+            unloaded.push_back(entity);
+        }
+    }
+
+    registry.destroy(unloaded.begin(), unloaded.end());
+}
+
+void Client::sendCommand(CommandType type, Fixed x, Fixed y) {
+    m_SocketClient.send(Networking::createPacket<C2S_COMMAND_PACKET>(Command{ .type = type, .x = x, .y = y }));
+}
+
+void Client::stepLockstep() {
+    if (!m_Lockstep || m_CommandFrames.empty()) return;
+
+    auto& registry = m_GameState.registry;
+
+    while (!m_CommandFrames.empty()) {
+        auto [tick, commands] = std::move(m_CommandFrames.front());
+        m_CommandFrames.pop_front();
+
+        if (tick != m_Simulation.tick()) {
+            LOG_WARNING("Skipping command frame", tick, "while at tick", m_Simulation.tick());
+            continue;
+        }
+
+        m_Simulation.step(commands);
+
+        if (tick % Lockstep::HASH_INTERVAL == 0) {
+            m_SocketClient.send(Networking::createPacket<C2S_STATE_HASH_PACKET>(tick, m_Simulation.hash()));
+        }
+    }
+
+    // the simulation only knows about game components, give its new soldiers something to draw with
+    double time = now();
+    for (auto entity: registry.view<Lockstep::FixedPosition, Soldier>(entt::exclude<InterpolatedPosition>)) {
+        const auto& position = registry.get<Lockstep::FixedPosition>(entity);
+        const auto& soldier = registry.get<Soldier>(entity);
+        registry.emplace<InterpolatedPosition>(entity, position.x.toFloat(), position.y.toFloat(), 0.15f, time);
+        registry.emplace<Hitbox>(entity, Hitbox(soldier.size, soldier.size / 2.f));
+    }
+
+    for (auto [entity, position, interpolated]:
+            registry.view<Lockstep::FixedPosition, InterpolatedPosition>().each()) {
+        float x = position.x.toFloat();
+        float y = position.y.toFloat();
+        if (x != interpolated.targetX || y != interpolated.targetY) interpolated.set(x, y, time);
+    }
+
+    m_GameState.players[m_SocketClient.getClientID()].gold = m_Simulation.gold(m_SocketClient.getClientID());
+}
+
+void Client::sendView(const RenderSnapshot& snapshot) {
+    // lockstep clients simulate the whole map
+    if (snapshot.lockstep) return;
+
+    const sf::View& view = m_Renderer.viewMain();
+    sf::Vector2f topLeft = view.getCenter() - view.getSize() / 2.f;
+    sf::Vector2f bottomRight = view.getCenter() + view.getSize() / 2.f;
+
+    // one chunk of margin so structures are there before they scroll in
+    constexpr float chunkPixels = 32.f * MAP_CHUNK_SIZE;
+    ChunkRect chunks{
+            static_cast<int>(std::floor(topLeft.x / chunkPixels)) - 1,
+            static_cast<int>(std::floor(topLeft.y / chunkPixels)) - 1,
+            static_cast<int>(std::floor(bottomRight.x / chunkPixels)) + 1,
+            static_cast<int>(std::floor(bottomRight.y / chunkPixels)) + 1
+    };
+
+    if (chunks == m_ViewChunks) return;
+    m_ViewChunks = chunks;
+
+    m_SocketClient.send(Networking::createPacket<C2S_VIEW_PACKET>(
+            chunks.minX, chunks.minY, chunks.maxX, chunks.maxY
+    ));
+}
+
 void Client::stop() {
     LOG_INFO("Stopping client");
-    if (!m_IsRunning) {
+    // the window closing and the server disconnecting can both stop the client, from different threads
+    if (!m_IsRunning.exchange(false)) {
         LOG_WARNING("Client isn't running");
         return;
     }
 
     m_SocketClient.stop();
-    m_IsRunning = false;
     LOG_INFO("Client stopped");
 }
 
+double Client::now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_StartTime).count();
+}
+
+void Client::networkThread() {
+    Utils::Profiler::setThreadName("client network");
+
+    // something arrived since the last snapshot
+    bool changed = false;
+    while (m_IsRunning) {
+        std::size_t handled;
+        {
+            PROFILE_SCOPE("Client::network");
+            handled = m_SocketClient.handleCallbacks();
+            stepLockstep();
+        }
+        changed = changed || handled > 0;
+
+        // at most one snapshot per frame, a burst of packets between two frames ends up in the same one
+        if (changed && m_Snapshots.consumed()) {
+            PROFILE_SCOPE("Client::snapshot");
+            m_Snapshots.back().build(m_GameState, m_SocketClient.getClientID(), m_Lockstep, now());
+            m_Snapshots.publish();
+            changed = false;
+        } else if (handled == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void Client::buildUI() {
+    const sf::Font& font = m_Renderer.font();
+
+    m_LobbyUI.clear();
+    m_PlayerList = &m_LobbyUI.add<UI::Container>();
+    m_ReadyLabel = &m_LobbyUI.add<UI::Label>(font, 30, sf::Vector2f{}, sf::Vector2f{ 0.5f, 1.f });
+    m_PlayersRevision = UINT32_MAX;
+
+    m_HudUI.clear();
+    m_GoldLabel = &m_HudUI.add<UI::Label>(font, 50, sf::Vector2f{ 10.f, 10.f });
+    m_GoldLabel->setPrefix("Gold: ");
+    m_GoldLabel->setStyle(sf::Text::Style::Bold);
+    m_GoldLabel->setColor(sf::Color::Yellow);
+
+    // the shop is centered on the ui view
+    sf::Vector2f shopOrigin{ 600.f, 300.f };
+    m_ShopUI.clear();
+    m_ShopUI.add<UI::Image>(m_Map.m_Shop).sprite().setOrigin(shopOrigin);
+
+    int count = std::min(static_cast<int>(s_ShopItems.size()), m_ShopSizeX * m_ShopSizeY);
+    m_ShopGrid = UI::Grid(sf::Vector2f{ 20.f, 20.f } - shopOrigin, { 216.f, 270.f }, { 20.f, 20.f }, m_ShopSizeX, count);
+    m_ShopCells.clear();
+    m_HoveredShopItem = -1;
+
+    for (int index = 0; index < count; index++) {
+        const ShopItem& item = s_ShopItems[index];
+        sf::Vector2f pos = m_ShopGrid.cell(index).position;
+
+        UI::Box& cell = m_ShopUI.add<UI::Box>(m_ShopGrid.cell(index));
+        styleShopCell(cell, false);
+        m_ShopCells.push_back(&cell);
+
+        // total 270
+        // 10 margin
+        // 30 text
+        // 10 margin
+        // 170 image
+        // 10 margin
+        // 30 price
+        // 10 margin
+
+        m_ShopUI.add<UI::Label>(font, 30, pos + sf::Vector2f{ 108.f, 10.f }, sf::Vector2f{ 0.5f, 0.f })
+                .setString(item.name);
+
+        UI::Image *image = nullptr;
+        switch (item.id) {
+            case ShopId::FARM: {
+                image = &m_ShopUI.add<UI::Image>(m_Map.m_FarmCollect);
+                break;
+            }
+            case ShopId::WALL: {
+                image = &m_ShopUI.add<UI::Image>(m_Map.m_Walls[0]);
+                break;
+            }
+            case ShopId::SOLDIER: {
+                image = &m_ShopUI.add<UI::Image>(m_Map.m_Soldier, sf::IntRect{{ 0,   0 },
+                                                                                { 320, 320 }});
+                image->sprite().setScale({ 0.1f, 0.1f });
+                break;
+            }
+        }
+        sf::Sprite& sprite = image->sprite();
+        sprite.setScale(sprite.getScale().componentWiseMul(sf::Vector2f{ 85.f, 85.f } / sprite.getGlobalBounds().size.x));
+        sprite.setPosition(pos + sf::Vector2f{ 108.f, 220.f });
+        sprite.setOrigin({ sprite.getLocalBounds().size.x / 2, sprite.getLocalBounds().size.y });
+
+        UI::Label& price = m_ShopUI.add<UI::Label>(font, 30, pos + sf::Vector2f{ 108.f, 230.f },
+                                                   sf::Vector2f{ 0.5f, 0.f });
+        price.setNumber(item.price);
+        price.setColor(sf::Color::Yellow);
+    }
+}
+
+void Client::updateLobbyUI(const RenderSnapshot& snapshot) {
+    if (m_PlayersRevision == snapshot.playersRevision) return;
+    m_PlayersRevision = snapshot.playersRevision;
+
+    const sf::Font& font = m_Renderer.font();
+    m_PlayerList->clear();
+
+    UI::Label& title = m_PlayerList->add<UI::Label>(font, 50, sf::Vector2f{ 10.f, 10.f });
+    title.setString("LOBBY");
+    title.setStyle(sf::Text::Style::Bold);
+
+    int i = 0;
+    for (auto& [id, player]: snapshot.players) {
+        UI::Label& label = m_PlayerList->add<UI::Label>(font, 30, sf::Vector2f{ 40.f, 100.f + i * 50.f });
+        label.setString(id == snapshot.self ? player.name + " (YOU)" : player.name);
+        label.setColor(player.ready ? sf::Color::Green : sf::Color::White);
+        ++i;
+    }
+
+    const ServerPlayerInfo *you = snapshot.player(snapshot.self);
+    bool ready = you && you->ready;
+    m_ReadyLabel->setString(ready ? "Ready" : "Press SPACE to be ready");
+    m_ReadyLabel->setColor(ready ? sf::Color::Green : sf::Color::Red);
+}
+
 void Client::tick(double deltaTime) {
     if (!m_IsRunning) {
         LOG_WARNING("Client isn't running");
         return;
     }
 
+    PROFILE_SCOPE("Client::tick");
+
     m_InputManager.update(m_Renderer.window());
 
     if (m_FocusTarget != FocusTarget::TARGET_NONE && m_InputManager.isPressed(sf::Keyboard::Key::Escape)) {
@@ -181,46 +456,26 @@ void Client::tick(double deltaTime) {
     m_SineTime += deltaTime;
     if (m_SineTime > 2 * M_PI) m_SineTime -= 2 * M_PI;
 
-    m_SocketClient.handleCallbacks();
+    // the network thread only publishes, everything below reads this one consistent state
+    const RenderSnapshot& snapshot = m_Snapshots.acquire();
+    if (snapshot.gameStage != m_DrawnStage) {
+        // a new game, the server doesn't know what this client sees yet
+        m_ViewChunks = ChunkRect{};
+        m_DrawnStage = snapshot.gameStage;
+    }
 
     m_Renderer.update();
     m_Renderer.window().clear(sf::Color::Black);
 
-    switch (m_GameState.gameStage) {
+    switch (snapshot.gameStage) {
         case GameStage::LOBBY: {
+            PROFILE_SCOPE("Client::ui");
             m_Renderer.setViewUI();
 
-            auto lobbyText = sf::Text(m_Renderer.font(), "LOBBY", 50);
-            lobbyText.setPosition(m_Renderer.uiTopLeft() + sf::Vector2f{ 10.f, 10.f });
-            lobbyText.setStyle(sf::Text::Style::Bold);
-            m_Renderer.window().draw(lobbyText);
-
-            {
-                int i = 0;
-                for (auto& [id, player]: m_GameState.players) {
-                    auto text = sf::Text(m_Renderer.font());
-                    if (id == m_SocketClient.getClientID()) text.setString(player.name + " (YOU)");
-                    else text.setString(player.name);
-                    text.setFillColor(player.ready ? sf::Color::Green : sf::Color::White);
-                    text.setPosition(m_Renderer.uiTopLeft() + sf::Vector2f{ 40, 100.f + i * 50 });
-                    m_Renderer.window().draw(text);
-                    ++i;
-                }
-            }
-
-            if (!m_GameState.players[m_SocketClient.getClientID()].ready) {
-                auto text = sf::Text(m_Renderer.font(), "Press SPACE to be ready");
-                text.setFillColor(sf::Color::Red);
-                text.setPosition(m_Renderer.uiBottomCenter() - sf::Vector2f{ 0, 20.f });
-                text.setOrigin(sf::Vector2f{ text.getGlobalBounds().size.x / 2.f, text.getGlobalBounds().size.y });
-                m_Renderer.window().draw(text);
-            } else {
-                auto text = sf::Text(m_Renderer.font(), "Ready");
-                text.setFillColor(sf::Color::Green);
-                text.setPosition(m_Renderer.uiBottomCenter() - sf::Vector2f{ 0, 20.f });
-                text.setOrigin(sf::Vector2f{ text.getGlobalBounds().size.x / 2.f, text.getGlobalBounds().size.y });
-                m_Renderer.window().draw(text);
-            }
+            updateLobbyUI(snapshot);
+            m_PlayerList->setPosition(m_Renderer.uiTopLeft());
+            m_ReadyLabel->setPosition(m_Renderer.uiBottomCenter() - sf::Vector2f{ 0, 20.f });
+            m_Renderer.window().draw(m_LobbyUI);
 
             break;
         }
@@ -235,15 +490,16 @@ void Client::tick(double deltaTime) {
                     m_Renderer.viewMain().move(cameraDelta.normalized() * 1000.f * (float) deltaTime);
             }
 
-            m_Map.render(deltaTime, m_Renderer, m_GameState.registry);
+            sendView(snapshot);
 
+            m_Map.render(deltaTime, m_Renderer, snapshot, now());
+
+            // everything drawn from here on is interface
+            PROFILE_SCOPE("Client::ui");
             m_Renderer.setViewUI();
-            auto goldText = sf::Text(m_Renderer.font(), "", 50);
-            goldText.setString("Gold: " + std::to_string(m_GameState.players[m_SocketClient.getClientID()].gold));
-            goldText.setPosition(m_Renderer.uiTopLeft() + sf::Vector2f{ 10.f, 10.f });
-            goldText.setStyle(sf::Text::Style::Bold);
-            goldText.setFillColor(sf::Color::Yellow);
-            m_Renderer.window().draw(goldText);
+            m_GoldLabel->setNumber(snapshot.gold);
+            m_HudUI.setPosition(m_Renderer.uiTopLeft());
+            m_Renderer.window().draw(m_HudUI);
 
             // get mouse position in world view
             sf::Vector2i mousePos = sf::Mouse::getPosition(m_Renderer.window());
@@ -253,32 +509,21 @@ void Client::tick(double deltaTime) {
             int tileX = static_cast<int>(std::floor(worldPos.x / 32.f));
             int tileY = static_cast<int>(std::floor(worldPos.y / 32.f));
 
-            {
-                m_GameState.registry.view<InterpolatedPosition>().each(
-                        [deltaTime](auto& position) { position.update(deltaTime); }
-                );
-            }
-
             switch (m_FocusTarget) {
                 case TARGET_NONE: {
-                    if (tileX >= 0 && tileX < m_GameState.mapInfo.size && tileY >= 0 &&
-                        tileY < m_GameState.mapInfo.size) {
-                        entt::entity hoverEntity = m_GameState.mapInfo.structures[tileY][tileX];
-                        if (hoverEntity != entt::null) {
-                            Structure& structure = m_GameState.registry.get<Structure>(hoverEntity);
-                            switch (structure.type) {
-                                case StructureType::FARM: {
-                                    if (m_InputManager.isReleased(sf::Mouse::Button::Left)) {
-                                        auto& farmComponent = m_GameState.registry.get<Farm>(hoverEntity);
-                                        auto& networkComponent = m_GameState.registry.get<NetworkID>(hoverEntity);
-                                        if (farmComponent.state == HARVEST) {
-                                            m_SocketClient
-                                                    .send(Networking::createPacket<C2S_HARVEST_PACKET>(
-                                                            networkComponent));
-                                        }
+                    if (const StructureSprite *structure = snapshot.structureAt(tileX, tileY)) {
+                        switch (structure->type) {
+                            case StructureType::FARM: {
+                                if (m_InputManager.isReleased(sf::Mouse::Button::Left) &&
+                                    structure->state == HARVEST) {
+                                    if (snapshot.lockstep) {
+                                        sendCommand(COMMAND_HARVEST, Fixed::fromInt(tileX), Fixed::fromInt(tileY));
+                                    } else {
+                                        m_SocketClient.send(
+                                                Networking::createPacket<C2S_HARVEST_PACKET>(structure->id));
                                     }
-                                    break;
                                 }
+                                break;
                             }
                         }
                     }
@@ -290,99 +535,29 @@ void Client::tick(double deltaTime) {
                     break;
                 }
                 case TARGET_SHOP: {
-                    // draw shop
-                    sf::Sprite shopSprite(m_ShopTexture);
-                    shopSprite.setPosition({ 0, 0 });
-                    shopSprite.setOrigin({ 600, 300 });
-                    m_Renderer.setViewUI();
-                    m_Renderer.window().draw(shopSprite);
-
-                    for (int i = 0; i < m_ShopSizeY; i++) {
-                        for (int j = 0; j < m_ShopSizeX; j++) {
-                            int index = i * m_ShopSizeX + j;
-                            if (index >= s_ShopItems.size()) break;
-
-                            const ShopItem& item = s_ShopItems[index];
-
-                            sf::Vector2f pos = sf::Vector2f{
-                                    static_cast<float>(20.f + j * 236),
-                                    static_cast<float>(20.f + i * 290)
-                            } - shopSprite.getOrigin();
-                            sf::Vector2f size{ 216, 270 };
-
-                            sf::FloatRect rect{ pos, size };
-                            bool hovered = rect.contains(uiPos);
-
-                            sf::RectangleShape itemSprite;
-                            itemSprite.setPosition(pos);
-                            itemSprite.setSize(size);
-                            itemSprite.setFillColor(sf::Color(0, 0, 0, hovered ? 50 : 20));
-                            itemSprite.setOutlineColor(sf::Color::Black);
-                            itemSprite.setOutlineThickness(3.f);
-                            if (hovered) itemSprite.setOutlineThickness(5.f);
-
-                            m_Renderer.window().draw(itemSprite);
-
-                            // total 270
-                            // 10 margin
-                            // 30 text
-                            // 10 margin
-                            // 170 image
-                            // 10 margin
-                            // 30 price
-                            // 10 margin
-
-                            sf::Text itemText(m_Renderer.font(), item.name, 30);
-                            itemText.setPosition(pos + sf::Vector2f{ 108.f, 10.f });
-                            itemText.setOrigin({ itemText.getLocalBounds().size.x / 2, 0 });
-                            itemText.setFillColor(sf::Color::White);
-                            m_Renderer.window().draw(itemText);
-
-                            sf::Sprite itemImage(m_Map.m_Wall0000);
-                            switch (item.id) {
-                                case ShopId::FARM: {
-                                    itemImage = sf::Sprite(m_Map.m_FarmCollectTexture);
-                                    break;
-                                }
-                                case ShopId::WALL: {
-                                    itemImage = sf::Sprite(m_Map.m_Wall0000);
-                                    break;
-                                }
-                                case ShopId::SOLDIER: {
-                                    itemImage = sf::Sprite(m_Map.m_SoldierTexture);
-                                    itemImage.setTextureRect({{ 0,   0 },
-                                                              { 320, 320 }});
-                                    itemImage.setScale({ 0.1f, 0.1f });
-                                    break;
-                                }
-                            }
-                            itemImage.setScale(itemImage.getScale().componentWiseMul(sf::Vector2f{ 85.f, 85.f } / itemImage.getGlobalBounds().size.x));
-                            itemImage.setPosition(pos + sf::Vector2f{ 108.f, 220.f });
-                            itemImage.setOrigin(
-                                    { itemImage.getLocalBounds().size.x / 2, itemImage.getLocalBounds().size.y });
-                            m_Renderer.window().draw(itemImage);
-
-                            sf::Text priceText(m_Renderer.font(), std::to_string(item.price), 30);
-                            priceText.setPosition(pos + sf::Vector2f{ 108.f, 230.f });
-                            priceText.setOrigin({ priceText.getLocalBounds().size.x / 2, 0 });
-                            priceText.setFillColor(sf::Color::Yellow);
-                            m_Renderer.window().draw(priceText);
-
-                            if (m_InputManager.isPressed(sf::Mouse::Button::Left) && hovered) {
-                                switch (item.id) {
-                                    case ShopId::FARM:
-                                    case ShopId::WALL:
-                                        m_FocusTarget = FocusTarget::TARGET_BUILDING;
-                                        break;
-
-                                    case ShopId::SOLDIER:
-                                        m_FocusTarget = FocusTarget::TARGET_SPAWN;
-                                        break;
-                                }
+                    int hovered = m_ShopGrid.hit(uiPos);
+                    if (hovered != m_HoveredShopItem) {
+                        if (m_HoveredShopItem >= 0) styleShopCell(*m_ShopCells[m_HoveredShopItem], false);
+                        if (hovered >= 0) styleShopCell(*m_ShopCells[hovered], true);
+                        m_HoveredShopItem = hovered;
+                    }
 
-                                m_SelectedShopItem = &s_ShopItems[index];
-                            }
+                    m_Renderer.setViewUI();
+                    m_Renderer.window().draw(m_ShopUI);
+
+                    if (m_InputManager.isPressed(sf::Mouse::Button::Left) && hovered >= 0) {
+                        switch (s_ShopItems[hovered].id) {
+                            case ShopId::FARM:
+                            case ShopId::WALL:
+                                m_FocusTarget = FocusTarget::TARGET_BUILDING;
+                                break;
+
+                            case ShopId::SOLDIER:
+                                m_FocusTarget = FocusTarget::TARGET_SPAWN;
+                                break;
                         }
+
+                        m_SelectedShopItem = &s_ShopItems[hovered];
                     }
 
                     if (m_InputManager.isPressed(sf::Keyboard::Key::B)) {
@@ -391,14 +566,12 @@ void Client::tick(double deltaTime) {
                     break;
                 }
                 case TARGET_BUILDING: {
-                    if (tileX >= 0 && tileX < m_GameState.mapInfo.size && tileY >= 0 &&
-                        tileY < m_GameState.mapInfo.size) {
-                        entt::entity hoverEntity = m_GameState.mapInfo.structures[tileY][tileX];
-                        if (hoverEntity == entt::null) {
+                    if (snapshot.inBounds(tileX, tileY)) {
+                        if (!snapshot.structureAt(tileX, tileY)) {
                             switch (m_SelectedShopItem->id) {
                                 case ShopId::WALL: {
                                     // draw a wall
-                                    sf::Sprite sprite(m_Map.m_Wall0000);
+                                    sf::Sprite sprite = m_Map.m_Walls[0].sprite();
                                     sprite.setPosition(
                                             { static_cast<float>(tileX) * 32, static_cast<float>(tileY) * 32 });
                                     sprite.setOrigin({ 0, 32 });
@@ -410,14 +583,18 @@ void Client::tick(double deltaTime) {
                                     m_Renderer.window().draw(sprite);
 
                                     if (m_InputManager.isPressed(sf::Mouse::Button::Left)) {
-                                        m_SocketClient
-                                                .send(Networking::createPacket<C2S_PLACE_WALL_PACKET>(tileX, tileY));
+                                        if (snapshot.lockstep) {
+                                            sendCommand(COMMAND_PLACE_WALL, Fixed::fromInt(tileX), Fixed::fromInt(tileY));
+                                        } else {
+                                            m_SocketClient
+                                                    .send(Networking::createPacket<C2S_PLACE_WALL_PACKET>(tileX, tileY));
+                                        }
                                     }
                                     break;
                                 }
                                 case ShopId::FARM: {
                                     // draw a wall
-                                    sf::Sprite sprite(m_Map.m_FarmCollectTexture);
+                                    sf::Sprite sprite = m_Map.m_FarmCollect.sprite();
                                     sprite.setPosition(
                                             { static_cast<float>(tileX) * 32, static_cast<float>(tileY + 1) * 32 });
                                     sprite.setOrigin({ 0, sprite.getLocalBounds().size.y });
@@ -429,8 +606,12 @@ void Client::tick(double deltaTime) {
                                     m_Renderer.window().draw(sprite);
 
                                     if (m_InputManager.isPressed(sf::Mouse::Button::Left)) {
-                                        m_SocketClient
-                                                .send(Networking::createPacket<C2S_PLANT_FARM_PACKET>(tileX, tileY));
+                                        if (snapshot.lockstep) {
+                                            sendCommand(COMMAND_PLANT_FARM, Fixed::fromInt(tileX), Fixed::fromInt(tileY));
+                                        } else {
+                                            m_SocketClient
+                                                    .send(Networking::createPacket<C2S_PLANT_FARM_PACKET>(tileX, tileY));
+                                        }
                                     }
                                     break;
                                 }
@@ -440,12 +621,10 @@ void Client::tick(double deltaTime) {
                     break;
                 }
                 case TARGET_SPAWN: {
-                    if (tileX >= 0 && tileX < m_GameState.mapInfo.size && tileY >= 0 &&
-                        tileY < m_GameState.mapInfo.size) {
+                    if (snapshot.inBounds(tileX, tileY)) {
 
-                        sf::Sprite sprite(m_Map.m_SoldierTexture);
-                        sprite.setTextureRect({{ 0,   0 },
-                                               { 320, 320 }});
+                        sf::Sprite sprite = m_Map.m_Soldier.sprite({{ 0,   0 },
+                                                                    { 320, 320 }});
                         sprite.setScale({ 0.1f, 0.1f });
                         sprite.setPosition(worldPos);
                         sprite.setOrigin({ 0, 320 });
@@ -457,7 +636,12 @@ void Client::tick(double deltaTime) {
                         m_Renderer.window().draw(sprite);
 
                         if (m_InputManager.isPressed(sf::Mouse::Button::Left)) {
-                            m_SocketClient.send(Networking::createPacket<C2S_SPAWN_SOLDIER_PACKET>(worldPos.x, worldPos.y));
+                            if (snapshot.lockstep) {
+                                sendCommand(COMMAND_SPAWN_SOLDIER, Fixed::fromFloat(worldPos.x),
+                                            Fixed::fromFloat(worldPos.y));
+                            } else {
+                                m_SocketClient.send(Networking::createPacket<C2S_SPAWN_SOLDIER_PACKET>(worldPos.x, worldPos.y));
+                            }
                         }
                     }
                     break;
@@ -466,7 +650,10 @@ void Client::tick(double deltaTime) {
             break;
         }
     }
-    m_Renderer.window().display();
+    {
+        PROFILE_SCOPE("Client::display");
+        m_Renderer.window().display();
+    }
 
     while (const std::optional event = m_Renderer.window().pollEvent()) {
         if (event->is<sf::Event::Closed>()) {
@@ -474,9 +661,16 @@ void Client::tick(double deltaTime) {
             stop();
         } else if (event->is<sf::Event::KeyPressed>()) {
             if (event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::Space &&
-                m_GameState.gameStage == LOBBY) {
-                m_SocketClient.send(Networking::createPacket<C2S_READY_PACKET>(
-                        !m_GameState.players[m_SocketClient.getClientID()].ready));
+                snapshot.gameStage == LOBBY) {
+                const ServerPlayerInfo *you = snapshot.player(snapshot.self);
+                m_SocketClient.send(Networking::createPacket<C2S_READY_PACKET>(!(you && you->ready)));
+            }
+
+            // F9 starts recording, pressing it again writes the trace
+            if (event->getIf<sf::Event::KeyPressed>()->code == sf::Keyboard::Key::F9) {
+                if (Utils::Profiler::enabled()) Utils::Profiler::requestDump();
+                LOG_INFO(Utils::Profiler::enabled() ? "Profiler stopped" : "Profiler started");
+                Utils::Profiler::setEnabled(!Utils::Profiler::enabled());
             }
         }
     }
@@ -494,10 +688,25 @@ void Client::run() {
     int fps = 0;
     float timeForFps = 0.f;
 
-    m_Renderer.init();
+    if (!m_Assets.open("assets.pak")) {
+        LOG_WARNING("No asset pack, loading the assets directory instead");
+        if (!m_Assets.openDirectory("assets")) throw std::runtime_error("Failed to load assets");
+    }
+
+    m_Renderer.init(m_Assets);
     m_Renderer.window().setVerticalSyncEnabled(true);
+    {
+        Utils::JobSystem jobs;
+        m_Map.load(m_Assets, jobs);
+    }
+    buildUI();
+
+    LOG_INFO("Loaded", m_Assets.size(), "assets, started in", clock.restart().asSeconds() * 1000.f, "ms");
 
     m_SocketClient.send(Networking::createPacket<C2S_NAME_PACKET>(m_Name));
+    // packets and the registry are handled there from now on
+    m_NetworkThread = std::thread(&Client::networkThread, this);
+
     while (m_IsRunning) {
         deltaTime = clock.restart().asSeconds();
         timeForFps += deltaTime;
@@ -510,5 +719,8 @@ void Client::run() {
         }
 
         tick(deltaTime);
+        Utils::Profiler::pollDump();
     }
+
+    if (m_NetworkThread.joinable()) m_NetworkThread.join();
 }
@@ -5,7 +5,15 @@
 #include "SFML/Network/IpAddress.hpp"
 #include "ClientGameState.h"
 #include "Client/Renderer/Renderer.h"
+#include "Client/Renderer/Widgets.h"
 #include "InputManager.h"
+#include "WallMask.h"
+#include "EntityUpdate.h"
+#include "Server/ChunkStreamer.h"
+#include "Lockstep/Simulation.h"
+#include <chrono>
+#include <deque>
+#include <thread>
 
 enum class ShopId {
     FARM,
@@ -40,12 +48,35 @@ public:
     void run();
 
 private:
+    void applyEntityUpdate(const EntityUpdate& update);
+    // destroys the structures whose top left tile is in the chunk
+    void unloadChunk(uint32_t chunk);
+    // tells the server which chunks are around the camera when that changes
+    void sendView(const RenderSnapshot& snapshot);
+
+    void sendCommand(CommandType type, Fixed x, Fixed y);
+    // runs every command frame that arrived and syncs what gets drawn with the simulation
+    void stepLockstep();
+
+    // lays out the lobby, hud and shop widgets, needs the font to be loaded
+    void buildUI();
+    // rebuilds the player list when someone joined, left or changed ready state
+    void updateLobbyUI(const RenderSnapshot& snapshot);
+
+    // seconds since the client was created, the clock interpolation and snapshots are timed with
+    [[nodiscard]] double now() const;
+    // handles packets, applies them to m_GameState and publishes snapshots of it for the renderer
+    void networkThread();
+
     void onCreateStructure(entt::registry& registry, entt::entity entity) {
         Structure& structureComponent = registry.get<Structure>(entity);
 
         for (int i = 0; i < structureComponent.size; i++)
             for (int j = 0; j < structureComponent.size; j++)
-                m_GameState.mapInfo.structures[structureComponent.y + i][structureComponent.x + j] = entity;
+                m_GameState.mapInfo.setStructure(structureComponent.x + j, structureComponent.y + i, entity);
+
+        if (structureComponent.type == WALL)
+            updateWallMasks(m_GameState.mapInfo, registry, structureComponent.x, structureComponent.y);
     }
 
     void onDeleteStructure(entt::registry& registry, entt::entity entity) {
@@ -53,7 +84,11 @@ private:
 
         for (int i = 0; i < structureComponent.size; i++)
             for (int j = 0; j < structureComponent.size; j++)
-                m_GameState.mapInfo.structures[structureComponent.y + i][structureComponent.x + j] = entt::null;
+                m_GameState.mapInfo.setStructure(structureComponent.x + j, structureComponent.y + i, entt::null);
+
+        // the tile is empty again, so only the neighbours get updated
+        if (structureComponent.type == WALL)
+            updateWallMasks(m_GameState.mapInfo, registry, structureComponent.x, structureComponent.y);
     }
 
     sf::IpAddress m_Ip;
@@ -61,8 +96,15 @@ private:
     Networking::SocketClient m_SocketClient;
     std::atomic<bool> m_IsRunning;
 
+    // only the network thread touches the game state once run() started it, the renderer draws m_Snapshots
     ClientGameState m_GameState;
+    SnapshotBuffer m_Snapshots;
+    std::thread m_NetworkThread;
+    std::chrono::steady_clock::time_point m_StartTime = std::chrono::steady_clock::now();
+
     InputManager m_InputManager;
+    // before the renderer and map, they read from it until they're gone
+    Utils::AssetPack m_Assets;
     Renderer m_Renderer;
     Map m_Map;
 
@@ -70,10 +112,30 @@ private:
     float m_SineTime = 0.0f;
 
     FocusTarget m_FocusTarget = TARGET_NONE;
+    ChunkRect m_ViewChunks;
+    GameStage m_DrawnStage = LOBBY;
+
+    bool m_Lockstep = false;
+    Lockstep::Simulation m_Simulation;
+    std::vector<EntityUpdate> m_StartWorld;
+    std::deque<std::pair<uint32_t, std::vector<Command>>> m_CommandFrames;
 
-    sf::Texture m_ShopTexture;
     const ShopItem *m_SelectedShopItem = nullptr;
 
+    UI::Container m_LobbyUI;
+    UI::Container *m_PlayerList = nullptr;
+    UI::Label *m_ReadyLabel = nullptr;
+    // no revision yet, so the first lobby frame builds the list
+    uint32_t m_PlayersRevision = UINT32_MAX;
+
+    UI::Container m_HudUI;
+    UI::Label *m_GoldLabel = nullptr;
+
+    UI::Container m_ShopUI;
+    UI::Grid m_ShopGrid;
+    std::vector<UI::Box *> m_ShopCells;
+    int m_HoveredShopItem = -1;
+
     static const std::vector<ShopItem> s_ShopItems;
     const int m_ShopSizeX = 5;
     const int m_ShopSizeY = 2;
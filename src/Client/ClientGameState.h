@@ -1,16 +1,60 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "Server/ServerGameState.h"
+#include "Server/Farm.h"
 #include "Map.h"
 #include "NetworkEntityMap.h"
+#include "WallMask.h"
 
 struct ClientGameState {
     GameStage gameStage = LOBBY;
     std::unordered_map<ID_t, ServerPlayerInfo> players;
+    // bumped when a player joins, leaves or changes ready state, the lobby list is only rebuilt then
+    uint32_t playersRevision = 0;
 
     MapInfo mapInfo;
 
     entt::registry registry;
     NetworkEntityMap NEP;
+
+    // per map chunk, bumped when a structure starting in it is built, removed or drawn differently.
+    // snapshots only copy the chunks whose revision moved since they last saw them
+    std::vector<uint32_t> chunkRevisions;
+
+    ClientGameState() {
+        registry.on_construct<Structure>().connect<&ClientGameState::onStructureChanged>(this);
+        registry.on_destroy<Structure>().connect<&ClientGameState::onStructureChanged>(this);
+        registry.on_construct<Farm>().connect<&ClientGameState::onStructureChanged>(this);
+        registry.on_update<Farm>().connect<&ClientGameState::onStructureChanged>(this);
+        registry.on_construct<WallMask>().connect<&ClientGameState::onStructureChanged>(this);
+        registry.on_update<WallMask>().connect<&ClientGameState::onStructureChanged>(this);
+    }
+
+    // the registry signals point at this
+    ClientGameState(const ClientGameState&) = delete;
+    ClientGameState& operator=(const ClientGameState&) = delete;
+
+    // 0 for chunks that never changed, any revision a chunk had is bigger
+    [[nodiscard]] uint32_t chunkRevision(uint32_t chunk) const {
+        return chunk < chunkRevisions.size() ? chunkRevisions[chunk] : 0;
+    }
+
+private:
+    void onStructureChanged(entt::registry& changed, entt::entity entity) {
+        const auto *structure = changed.try_get<Structure>(entity);
+        if (!structure) return;
+
+        uint32_t chunk = mapInfo.chunkIndex(structure->x, structure->y);
+        if (chunk == MAP_CHUNK_NONE) return;
+
+        // a new map, everything a snapshot had is stale
+        size_t chunks = static_cast<size_t>(mapInfo.chunksPerSide()) * mapInfo.chunksPerSide();
+        if (chunkRevisions.size() != chunks) chunkRevisions.assign(chunks, ++m_Revision);
+
+        chunkRevisions[chunk] = ++m_Revision;
+    }
+
+    uint32_t m_Revision = 0;
 };
@@ -0,0 +1,85 @@
+#include "GroundLayer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr float TILE_SIZE = 32.f;
+}
+
+void GroundLayer::render(sf::RenderTarget& target, const AtlasRegion& tile, uint32_t mapSize,
+                         sf::FloatRect visible) {
+    // a new game or a different map size throws away everything baked for the old one
+    if (mapSize != m_MapSize) {
+        m_MapSize = mapSize;
+        m_ChunksPerSide = (mapSize + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+        m_Chunks.assign(static_cast<size_t>(m_ChunksPerSide) * m_ChunksPerSide, sf::VertexArray());
+        m_Dirty.assign(m_Chunks.size(), true);
+    }
+
+    m_DrawnChunks = 0;
+    if (m_ChunksPerSide == 0) return;
+
+    constexpr float chunkSize = TILE_SIZE * MAP_CHUNK_SIZE;
+    int last = static_cast<int>(m_ChunksPerSide) - 1;
+    int minX = std::max(0, static_cast<int>(std::floor(visible.position.x / chunkSize)));
+    int minY = std::max(0, static_cast<int>(std::floor(visible.position.y / chunkSize)));
+    int maxX = std::min(last, static_cast<int>(std::floor((visible.position.x + visible.size.x) / chunkSize)));
+    int maxY = std::min(last, static_cast<int>(std::floor((visible.position.y + visible.size.y) / chunkSize)));
+
+    sf::RenderStates states(tile.texture);
+    for (int y = minY; y <= maxY; y++) {
+        for (int x = minX; x <= maxX; x++) {
+            uint32_t chunk = static_cast<uint32_t>(y) * m_ChunksPerSide + static_cast<uint32_t>(x);
+            if (m_Dirty[chunk]) bake(chunk, tile);
+
+            target.draw(m_Chunks[chunk], states);
+            m_DrawnChunks++;
+        }
+    }
+}
+
+void GroundLayer::invalidate(uint32_t chunk) {
+    if (chunk < m_Dirty.size()) m_Dirty[chunk] = true;
+}
+
+void GroundLayer::invalidateAll() {
+    std::fill(m_Dirty.begin(), m_Dirty.end(), true);
+}
+
+void GroundLayer::bake(uint32_t chunk, const AtlasRegion& tile) {
+    int originX = static_cast<int>(chunk % m_ChunksPerSide) * MAP_CHUNK_SIZE;
+    int originY = static_cast<int>(chunk / m_ChunksPerSide) * MAP_CHUNK_SIZE;
+    // chunks on the right and bottom edge are cut off when the map size isn't a multiple of the chunk size
+    int width = std::min(MAP_CHUNK_SIZE, static_cast<int>(m_MapSize) - originX);
+    int height = std::min(MAP_CHUNK_SIZE, static_cast<int>(m_MapSize) - originY);
+
+    sf::Vector2f uvTopLeft(tile.rect.position);
+    sf::Vector2f uvBottomRight(tile.rect.position + tile.rect.size);
+    sf::Vector2f uvTopRight(uvBottomRight.x, uvTopLeft.y);
+    sf::Vector2f uvBottomLeft(uvTopLeft.x, uvBottomRight.y);
+
+    sf::VertexArray& vertices = m_Chunks[chunk];
+    vertices.setPrimitiveType(sf::PrimitiveType::Triangles);
+    vertices.resize(static_cast<size_t>(width) * height * 6);
+
+    size_t index = 0;
+    for (int y = originY; y < originY + height; y++) {
+        for (int x = originX; x < originX + width; x++) {
+            sf::Vector2f topLeft(static_cast<float>(x) * TILE_SIZE, static_cast<float>(y) * TILE_SIZE);
+            sf::Vector2f topRight = topLeft + sf::Vector2f(TILE_SIZE, 0);
+            sf::Vector2f bottomLeft = topLeft + sf::Vector2f(0, TILE_SIZE);
+            sf::Vector2f bottomRight = topLeft + sf::Vector2f(TILE_SIZE, TILE_SIZE);
+
+            vertices[index++] = { topLeft, sf::Color::White, uvTopLeft };
+            vertices[index++] = { topRight, sf::Color::White, uvTopRight };
+            vertices[index++] = { bottomLeft, sf::Color::White, uvBottomLeft };
+            vertices[index++] = { bottomLeft, sf::Color::White, uvBottomLeft };
+            vertices[index++] = { topRight, sf::Color::White, uvTopRight };
+            vertices[index++] = { bottomRight, sf::Color::White, uvBottomRight };
+        }
+    }
+
+    m_Dirty[chunk] = false;
+    m_BakedChunks++;
+}
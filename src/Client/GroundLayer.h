@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "SFML/Graphics.hpp"
+#include "Server/MapInfo.h"
+#include "Renderer/TextureAtlas.h"
+
+// the ground baked into one vertex array per map chunk, so drawing it costs a draw call per visible chunk
+// instead of one per tile. chunks are baked the first time they're seen and again only once invalidated
+class GroundLayer {
+public:
+    // draws every chunk overlapping the rectangle, in world coordinates, for a map of mapSize tiles per side
+    void render(sf::RenderTarget& target, const AtlasRegion& tile, uint32_t mapSize, sf::FloatRect visible);
+
+    // rebakes the chunk the next time it's drawn, for when the ground under it changes
+    void invalidate(uint32_t chunk);
+    void invalidateAll();
+
+    [[nodiscard]] uint32_t bakedChunks() const { return m_BakedChunks; }
+    // by the last render(), one draw call each
+    [[nodiscard]] uint32_t drawnChunks() const { return m_DrawnChunks; }
+
+private:
+    void bake(uint32_t chunk, const AtlasRegion& tile);
+
+    uint32_t m_MapSize = 0;
+    uint32_t m_ChunksPerSide = 0;
+    uint32_t m_BakedChunks = 0;
+    uint32_t m_DrawnChunks = 0;
+
+    std::vector<sf::VertexArray> m_Chunks;
+    std::vector<bool> m_Dirty;
+};
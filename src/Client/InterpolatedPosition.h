@@ -3,33 +3,32 @@
 #include <algorithm>
 #include <cmath>
 
+// eases from where it was towards the last position it was set to over interpolateTime seconds. times are seconds
+// on the client clock, so it can be sampled at any moment instead of being stepped every frame
 struct InterpolatedPosition {
-    float x;
-    float y;
-
     float oldX;
     float oldY;
     float targetX;
     float targetY;
 
-    float time;
+    double start;
     float interpolateTime;
 
-    InterpolatedPosition(float x, float y, float interpolateTime) : x(x), y(y), oldX(x), oldY(y), targetX(x), targetY(y), time(0), interpolateTime(interpolateTime) {}
+    InterpolatedPosition(float x, float y, float interpolateTime, double now)
+            : oldX(x), oldY(y), targetX(x), targetY(y), start(now), interpolateTime(interpolateTime) {}
 
-    void set(float newX, float newY) {
-        oldX = x;
-        oldY = y;
-        targetX = newX;
-        targetY = newY;
-        time = 0;
+    [[nodiscard]] float progress(double now) const {
+        return std::clamp(static_cast<float>((now - start) / interpolateTime), 0.f, 1.f);
     }
 
-    void update(float dt) {
-        time += dt;
-        time = std::clamp(time, 0.f, interpolateTime);
+    [[nodiscard]] float x(double now) const { return std::lerp(oldX, targetX, progress(now)); }
+    [[nodiscard]] float y(double now) const { return std::lerp(oldY, targetY, progress(now)); }
 
-        x = std::lerp(oldX, targetX, time / interpolateTime);
-        y = std::lerp(oldY, targetY, time / interpolateTime);
+    void set(float newX, float newY, double now) {
+        oldX = x(now);
+        oldY = y(now);
+        targetX = newX;
+        targetY = newY;
+        start = now;
     }
 };
@@ -1,160 +1,268 @@
 #include "Map.h"
 #include "logy.h"
 #include "Server/Farm.h"
-#include "Client/Renderer/YSort.h"
-#include "Server/Soldier.h"
-#include "Server/Position.h"
-#include "InterpolatedPosition.h"
 #include "Server/Hitbox.h"
 #include "opts.h"
+#include "Utils/Profiler.h"
 
-Map::Map(MapInfo *mapInfo) : m_MapInfo(mapInfo) {
-    if (!m_GrassTexture.loadFromFile("assets/grass.png")) {
-        LOG_WARNING("Failed to load grass texture");
-    }
+#include <algorithm>
+#include <cmath>
 
-    if (!m_CastleTexture.loadFromFile("assets/castle.png")) {
-        LOG_WARNING("Failed to load castle texture");
-    }
+namespace {
+// the fence textures are named after their neighbour mask, up right down left
+std::string fenceName(int mask) {
+    std::string name = "fence_";
+    for (int bit = 3; bit >= 0; bit--) name += (mask >> bit) & 1 ? '1' : '0';
+    return name;
+}
+}
 
-    if (!m_FarmEmptyTexture.loadFromFile("assets/farm_empty.png")) {
-        LOG_WARNING("Failed to load farm texture");
-    }
+Map::Map() {
 
-    if (!m_FarmCollectTexture.loadFromFile("assets/farm_collect.png")) {
-        LOG_WARNING("Failed to load farm texture");
-    }
+}
+
+void Map::load(const Utils::AssetPack& assets, Utils::JobSystem& jobs) {
+    sf::Clock clock;
+
+    std::vector<std::string> names = { "grass", "castle", "farm_empty", "farm_collect", "soldier", "shop" };
+    for (int mask = 0; mask < 16; mask++) names.push_back(fenceName(mask));
 
-    if (!m_Wall0000.loadFromFile("assets/fence_0000.png") ||
-        !m_Wall0001.loadFromFile("assets/fence_0001.png") ||
-        !m_Wall0010.loadFromFile("assets/fence_0010.png") ||
-        !m_Wall0011.loadFromFile("assets/fence_0011.png") ||
-        !m_Wall0100.loadFromFile("assets/fence_0100.png") ||
-        !m_Wall0101.loadFromFile("assets/fence_0101.png") ||
-        !m_Wall0110.loadFromFile("assets/fence_0110.png") ||
-        !m_Wall0111.loadFromFile("assets/fence_0111.png") ||
-        !m_Wall1000.loadFromFile("assets/fence_1000.png") ||
-        !m_Wall1001.loadFromFile("assets/fence_1001.png") ||
-        !m_Wall1010.loadFromFile("assets/fence_1010.png") ||
-        !m_Wall1011.loadFromFile("assets/fence_1011.png") ||
-        !m_Wall1100.loadFromFile("assets/fence_1100.png") ||
-        !m_Wall1101.loadFromFile("assets/fence_1101.png") ||
-        !m_Wall1110.loadFromFile("assets/fence_1110.png") ||
-        !m_Wall1111.loadFromFile("assets/fence_1111.png")) {
-        LOG_WARNING("Failed to load fence texture");
+    // decoding is most of the load and every image is independent, the pack is only read
+    std::vector<sf::Image> images(names.size());
+    std::vector<char> decoded(names.size(), false);
+    jobs.parallelFor(names.size(), 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; i++) {
+            std::span<const char> data = assets.get(names[i] + ".png");
+            decoded[i] = !data.empty() && images[i].loadFromMemory(data.data(), data.size());
+        }
+    });
+
+    float decodeTime = clock.restart().asSeconds();
+
+    for (size_t i = 0; i < names.size(); i++) {
+        if (!decoded[i]) {
+            LOG_WARNING("Failed to load texture", names[i]);
+            images[i] = sf::Image({ 32, 32 }, sf::Color::Transparent);
+        }
+        m_Atlas.add(names[i], std::move(images[i]));
     }
 
-    if (!m_SoldierTexture.loadFromFile("assets/soldier.png")) {
-        LOG_WARNING("Failed to load soldier texture");
+    // the textures are created here, on the thread that renders
+    m_Atlas.pack();
+
+    m_Grass = m_Atlas.region("grass");
+    m_Castle = m_Atlas.region("castle");
+    m_FarmEmpty = m_Atlas.region("farm_empty");
+    m_FarmCollect = m_Atlas.region("farm_collect");
+    m_Soldier = m_Atlas.region("soldier");
+    m_Shop = m_Atlas.region("shop");
+    for (int mask = 0; mask < 16; mask++) {
+        m_Walls[mask] = m_Atlas.region(fenceName(mask));
     }
+
+    LOG_INFO("Decoded", names.size(), "textures in", decodeTime * 1000.f, "ms on", jobs.workerCount(),
+             "workers, uploaded", m_Atlas.pageCount(), "atlas pages in", clock.getElapsedTime().asSeconds() * 1000.f,
+             "ms");
 }
 
 Map::~Map() {
 
 }
 
-void Map::render(double dt, Renderer& renderer, entt::registry& registry) {
-    registry.sort<YSort>([](const YSort& a, const YSort& b) {
-        return a.y < b.y;
-    });
+void Map::render(double dt, Renderer& renderer, const RenderSnapshot& snapshot, double now) {
+    PROFILE_SCOPE("Map::render");
 
     renderer.setViewMain();
 
-    for (int y = 0; y < m_MapInfo->size; y++) {
-        for (int x = 0; x < m_MapInfo->size; x++) {
-            sf::Sprite sprite(m_GrassTexture);
-            sprite.setPosition({ static_cast<float>(x) * 32, static_cast<float>(y) * 32 });
-            renderer.window().draw(sprite);
-        }
-    }
+    // only the chunks under the camera, big maps have thousands of them
+    const sf::View& view = renderer.viewMain();
+    sf::FloatRect visible(view.getCenter() - view.getSize() / 2.f, view.getSize());
+    m_Ground.render(renderer.target(), m_Grass, snapshot.mapSize, visible);
 
     if (m_AnimationTimer.timeReached(dt)) {
         ++m_AnimationIndex %= 4;
     }
 
-    auto drawView = registry.view<YSort>();
-    for (auto entity: drawView) {
-        auto *structure = registry.try_get<Structure>(entity);
-        if (structure) {
-            switch (structure->type) {
-                case CASTLE: {
-                    sf::Sprite sprite(m_CastleTexture);
-                    sprite.setPosition(
-                            { static_cast<float>(structure->x) * 32, static_cast<float>(structure->y) * 32 });
-                    sprite.setOrigin({ 0, sprite.getGlobalBounds().size.y - structure->size * 32 });
-                    renderer.window().draw(sprite);
-                    break;
-                }
-                case FARM: {
-                    if (!registry.all_of<Farm>(entity)) continue;
-                    sf::Sprite sprite(
-                            registry.get<Farm>(entity).state == HARVEST ? m_FarmCollectTexture : m_FarmEmptyTexture);
-                    sprite.setPosition(
-                            { static_cast<float>(structure->x) * 32, static_cast<float>(structure->y) * 32 });
-                    renderer.window().draw(sprite);
-                    break;
-                }
-                case WALL: {
-                    uint8_t neighbourMask = 0;
-                    if (structure->y > 0 && m_MapInfo->structures[structure->y - 1][structure->x] != entt::null) {
-                        auto& wall = registry.get<Structure>(m_MapInfo->structures[structure->y - 1][structure->x]);
-                        if (wall.type == WALL && structure->owner == wall.owner) {
-                            neighbourMask |= 0b1000;
-                        }
-                    }
-                    if (structure->x < m_MapInfo->size - 1 &&
-                        m_MapInfo->structures[structure->y][structure->x + 1] != entt::null) {
-                        auto& wall = registry.get<Structure>(m_MapInfo->structures[structure->y][structure->x + 1]);
-                        if (wall.type == WALL && structure->owner == wall.owner) {
-                            neighbourMask |= 0b0100;
-                        }
-                    }
-                    if (structure->y < m_MapInfo->size - 1 &&
-                        m_MapInfo->structures[structure->y + 1][structure->x] != entt::null) {
-                        auto& wall = registry.get<Structure>(m_MapInfo->structures[structure->y + 1][structure->x]);
-                        if (wall.type == WALL && structure->owner == wall.owner) {
-                            neighbourMask |= 0b0010;
-                        }
-                    }
-                    if (structure->x > 0 && m_MapInfo->structures[structure->y][structure->x - 1] != entt::null) {
-                        auto& wall = registry.get<Structure>(m_MapInfo->structures[structure->y][structure->x - 1]);
-                        if (wall.type == WALL && structure->owner == wall.owner) {
-                            neighbourMask |= 0b0001;
-                        }
-                    }
-
-                    sf::Sprite sprite(*m_WallTextures[neighbourMask]);
-                    sprite.setPosition(
-                            { static_cast<float>(structure->x) * 32, static_cast<float>(structure->y) * 32 });
-                    sprite.setOrigin({ 0, 32 });
-
-                    renderer.window().draw(sprite);
-                    break;
+    auto age = static_cast<float>(now - snapshot.time);
+    collectVisible(snapshot, visible, age);
+
+    SpriteBatch& batch = renderer.batch();
+
+    // on the same y the structure is drawn first
+    size_t structure = 0;
+    size_t soldier = 0;
+    while (structure < m_VisibleStructures.size() || soldier < m_VisibleSoldiers.size()) {
+        if (soldier < m_VisibleSoldiers.size() && (structure == m_VisibleStructures.size() ||
+                m_VisibleSoldiers[soldier].first < m_VisibleStructures[structure]->sortY())) {
+            drawSoldier(batch, snapshot.soldiers[m_VisibleSoldiers[soldier++].second], age);
+        } else {
+            drawStructure(batch, *m_VisibleStructures[structure++]);
+        }
+    }
+
+#if LTK_DEBUG
+    // on top of everything, so they don't split the sprites into a draw call per soldier
+    for (auto [y, index]: m_VisibleSoldiers) {
+        const SoldierSprite& soldier = snapshot.soldiers[index];
+        Hitbox hitbox(soldier.size, soldier.size / 2.f);
+        batch.rect(hitbox.getRect({ soldier.x(age) + soldier.size / 2, soldier.y(age) }), { 255, 0, 0, 100 });
+    }
+#endif
+
+    batch.flush();
+}
+
+void Map::drawStructure(SpriteBatch& batch, const StructureSprite& structure) {
+    sf::Vector2f position{ static_cast<float>(structure.x) * 32, static_cast<float>(structure.y) * 32 };
+    switch (structure.type) {
+        case CASTLE: {
+            float height = static_cast<float>(m_Castle.rect.size.y);
+            batch.draw(m_Castle, position, { 0, height - static_cast<float>(structure.size) * 32 });
+            break;
+        }
+        case FARM: {
+            batch.draw(structure.state == HARVEST ? m_FarmCollect : m_FarmEmpty, position);
+            break;
+        }
+        case WALL: {
+            batch.draw(m_Walls[structure.state & 0xF], position, { 0, 32 });
+            break;
+        }
+    }
+}
+
+void Map::drawSoldier(SpriteBatch& batch, const SoldierSprite& soldier, float age) {
+    batch.draw(m_Soldier, {{ m_AnimationIndex * 320, 0 },
+                           { 320,                    320 }},
+               { soldier.x(age), soldier.y(age) }, { 0, static_cast<float>(m_Soldier.rect.size.y) },
+               { 0.1f, 0.1f });
+}
+
+void Map::collectVisible(const RenderSnapshot& snapshot, sf::FloatRect visible, float age) {
+    PROFILE_SCOPE("Map::collectVisible");
+
+    m_VisibleStructures.clear();
+    m_VisibleSoldiers.clear();
+    if (snapshot.mapSize == 0) return;
+
+    // sprites reach outside the tiles and points they're anchored to, castles and walls stick out above their
+    // tiles and soldiers are drawn up and to the right of their position
+    sf::FloatRect area(visible.position - sf::Vector2f(CULL_MARGIN, CULL_MARGIN),
+                       visible.size + sf::Vector2f(2 * CULL_MARGIN, 2 * CULL_MARGIN));
+
+    int last = static_cast<int>(snapshot.mapSize) - 1;
+    int minX = std::max(0, static_cast<int>(std::floor(area.position.x / 32)));
+    int minY = std::max(0, static_cast<int>(std::floor(area.position.y / 32)));
+    int maxX = std::min(last, static_cast<int>(std::floor((area.position.x + area.size.x) / 32)));
+    int maxY = std::min(last, static_cast<int>(std::floor((area.position.y + area.size.y) / 32)));
+
+    // structures are bucketed by the chunk of their top left tile, so the chunks up and left of the area are
+    // looked at too for big structures reaching into it
+    int lastChunk = static_cast<int>(snapshot.chunksPerSide) - 1;
+    int minChunkX = std::max(0, (minX - snapshot.maxStructureSize + 1) / MAP_CHUNK_SIZE);
+    int minChunkY = std::max(0, (minY - snapshot.maxStructureSize + 1) / MAP_CHUNK_SIZE);
+    int maxChunkX = std::min(lastChunk, maxX / MAP_CHUNK_SIZE);
+    int maxChunkY = std::min(lastChunk, maxY / MAP_CHUNK_SIZE);
+
+    for (int chunkY = minChunkY; chunkY <= maxChunkY && minY <= maxY; chunkY++) {
+        for (int chunkX = minChunkX; chunkX <= maxChunkX && minX <= maxX; chunkX++) {
+            size_t chunk = static_cast<size_t>(chunkY) * snapshot.chunksPerSide + chunkX;
+            size_t middle = m_VisibleStructures.size();
+            for (const StructureSprite& structure: snapshot.chunks[chunk].structures) {
+                if (structure.x > maxX || structure.x + structure.size - 1 < minX ||
+                    structure.y > maxY || structure.y + structure.size - 1 < minY) {
+                    continue;
                 }
+
+                m_VisibleStructures.push_back(&structure);
             }
+
+            mergeStructures(middle);
         }
+    }
 
-        auto *soldier = registry.try_get<Soldier>(entity);
-        if (soldier) {
-            auto position = registry.get<InterpolatedPosition>(entity);
-            auto hitbox = registry.get<Hitbox>(entity);
+    int lastCell = static_cast<int>(snapshot.cellsPerSide) - 1;
+    constexpr float cellSize = RenderSnapshot::SOLDIER_CELL_SIZE;
+    int minColumn = std::max(0, static_cast<int>(std::floor(area.position.x / cellSize)));
+    int minRow = std::max(0, static_cast<int>(std::floor(area.position.y / cellSize)));
+    int maxColumn = std::min(lastCell, static_cast<int>(std::floor((area.position.x + area.size.x) / cellSize)));
+    int maxRow = std::min(lastCell, static_cast<int>(std::floor((area.position.y + area.size.y) / cellSize)));
 
-            sf::Sprite sprite(m_SoldierTexture);
-            sprite.scale({ 0.1f, 0.1f });
-            sprite.setPosition({ position.x, position.y });
-            sprite.setOrigin({ 0, static_cast<float>(m_SoldierTexture.getSize().y) });
-            sprite.setTextureRect({{ m_AnimationIndex * 320, 0 },
-                                   { 320,                    320 }});
-            renderer.window().draw(sprite);
+    for (int row = minRow; row <= maxRow && minColumn <= maxColumn; row++) {
+        // a row of cells is one contiguous range of soldiers
+        size_t first = static_cast<size_t>(row) * snapshot.cellsPerSide;
+        for (uint32_t i = snapshot.cellStarts[first + minColumn]; i < snapshot.cellStarts[first + maxColumn + 1]; i++) {
+            const SoldierSprite& soldier = snapshot.soldiers[i];
+            sf::Vector2f position{ soldier.x(age), soldier.y(age) };
+            if (!area.contains(position)) continue;
 
-#if LTK_DEBUG
-            sf::FloatRect hitboxRect = hitbox.getRect({ position.x + soldier->size / 2, position.y });
-            sf::RectangleShape hitboxShape;
-            hitboxShape.setPosition({ hitboxRect.position.x, hitboxRect.position.y });
-            hitboxShape.setSize({ hitboxRect.size.x, hitboxRect.size.y });
-            hitboxShape.setFillColor({ 255, 0, 0, 100 });
-            renderer.window().draw(hitboxShape);
-#endif
+            m_VisibleSoldiers.emplace_back(position.y, i);
+        }
+    }
+
+    sortSoldiers();
+}
+
+void Map::mergeStructures(size_t middle) {
+    auto& structures = m_VisibleStructures;
+    if (middle == 0 || middle == structures.size()) return;
+
+    auto before = [](const StructureSprite *a, const StructureSprite *b) { return a->sortY() < b->sortY(); };
+
+    // everything drawn before the chunk's first structure stays where it is
+    auto first = static_cast<size_t>(std::upper_bound(structures.begin(), structures.begin() + middle,
+                                                      structures[middle], before) - structures.begin());
+    if (first == middle) return;
+
+    // std::inplace_merge allocates its buffer on every call
+    m_MergeScratch.assign(structures.begin() + static_cast<std::ptrdiff_t>(first),
+                          structures.begin() + static_cast<std::ptrdiff_t>(middle));
+    size_t out = first;
+    size_t next = middle;
+    for (const StructureSprite *structure: m_MergeScratch) {
+        while (next < structures.size() && before(structures[next], structure)) structures[out++] = structures[next++];
+        structures[out++] = structure;
+    }
+}
+
+void Map::sortSoldiers() {
+    if (m_VisibleSoldiers.size() < 2) return;
+
+    float minY = m_VisibleSoldiers.front().first;
+    float maxY = minY;
+    for (const auto& [y, index]: m_VisibleSoldiers) {
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+    }
+
+    // the visible set spans a screen's worth of rows, anything else is a broken position
+    float span = (maxY - minY) / 32.f;
+    if (!(span < MAX_SORT_ROWS)) {
+        std::stable_sort(m_VisibleSoldiers.begin(), m_VisibleSoldiers.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+        return;
+    }
+
+    // counting sort by tile row, linear in the number of soldiers and rows
+    auto row = [minY](float y) { return static_cast<size_t>((y - minY) / 32.f); };
+    size_t rows = static_cast<size_t>(span) + 1;
+    m_SortRows.assign(rows + 1, 0);
+    for (const auto& [y, index]: m_VisibleSoldiers) m_SortRows[row(y) + 1]++;
+    for (size_t i = 1; i <= rows; i++) m_SortRows[i] += m_SortRows[i - 1];
+
+    m_SortScratch.resize(m_VisibleSoldiers.size());
+    for (const auto& entry: m_VisibleSoldiers) m_SortScratch[m_SortRows[row(entry.first)]++] = entry;
+    std::swap(m_VisibleSoldiers, m_SortScratch);
+
+    // only soldiers in the same row can still be out of order
+    for (size_t i = 1; i < m_VisibleSoldiers.size(); i++) {
+        auto entry = m_VisibleSoldiers[i];
+        size_t j = i;
+        while (j > 0 && m_VisibleSoldiers[j - 1].first > entry.first) {
+            m_VisibleSoldiers[j] = m_VisibleSoldiers[j - 1];
+            j--;
         }
+        m_VisibleSoldiers[j] = entry;
     }
 }
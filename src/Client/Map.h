@@ -1,51 +1,70 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <utility>
+#include <vector>
 #include "Renderer/Renderer.h"
-#include "Server/MapInfo.h"
-#include "entt/entt.hpp"
+#include "Renderer/TextureAtlas.h"
 #include "Utils/Timers.h"
+#include "Utils/AssetPack.h"
+#include "Utils/JobSystem.h"
+#include "GroundLayer.h"
+#include "RenderSnapshot.h"
 
 class Map {
 public:
-    Map(MapInfo *mapInfo);
+    Map();
     ~Map();
 
-    void render(double dt, Renderer& renderer, entt::registry &registry);
-
-    sf::Texture m_GrassTexture;
-    sf::Texture m_CastleTexture;
-    sf::Texture m_FarmEmptyTexture;
-    sf::Texture m_FarmCollectTexture;
-
-    sf::Texture m_Wall0000;
-    sf::Texture m_Wall0001;
-    sf::Texture m_Wall0010;
-    sf::Texture m_Wall0011;
-    sf::Texture m_Wall0100;
-    sf::Texture m_Wall0101;
-    sf::Texture m_Wall0110;
-    sf::Texture m_Wall0111;
-    sf::Texture m_Wall1000;
-    sf::Texture m_Wall1001;
-    sf::Texture m_Wall1010;
-    sf::Texture m_Wall1011;
-    sf::Texture m_Wall1100;
-    sf::Texture m_Wall1101;
-    sf::Texture m_Wall1110;
-    sf::Texture m_Wall1111;
-
-    sf::Texture m_SoldierTexture;
+    // decodes the map and shop images on the workers and packs them into the atlas on the calling thread,
+    // which has to be the one that renders
+    void load(const Utils::AssetPack& assets, Utils::JobSystem& jobs);
+
+    // now is the client clock, soldiers are drawn where they are at that moment
+    void render(double dt, Renderer& renderer, const RenderSnapshot& snapshot, double now);
+
+    // entities drawn last frame
+    [[nodiscard]] size_t visibleCount() const { return m_VisibleStructures.size() + m_VisibleSoldiers.size(); }
+    // draw calls of the ground last frame, the sprites are counted by the renderer's batch
+    [[nodiscard]] uint32_t groundDrawCalls() const { return m_Ground.drawnChunks(); }
+
+    // every map and shop sprite, packed by load()
+    TextureAtlas m_Atlas;
+    AtlasRegion m_Grass;
+    AtlasRegion m_Castle;
+    AtlasRegion m_FarmEmpty;
+    AtlasRegion m_FarmCollect;
+    // indexed by the wall neighbour mask
+    std::array<AtlasRegion, 16> m_Walls;
+    AtlasRegion m_Soldier;
+    AtlasRegion m_Shop;
+
     int m_AnimationIndex = 0;
     Utils::Timers::NonBlockingTimer<2> m_AnimationTimer;
 
 private:
-    sf::Texture* m_WallTextures[16] = {
-            &m_Wall0000, &m_Wall0001, &m_Wall0010, &m_Wall0011,
-            &m_Wall0100, &m_Wall0101, &m_Wall0110, &m_Wall0111,
-            &m_Wall1000, &m_Wall1001, &m_Wall1010, &m_Wall1011,
-            &m_Wall1100, &m_Wall1101, &m_Wall1110, &m_Wall1111
-    };
-
-    MapInfo *m_MapInfo;
+    // how far outside the view a sprite's anchor can be while the sprite still reaches into it
+    static constexpr float CULL_MARGIN = 64.f;
+    static constexpr float MAX_SORT_ROWS = 4096.f;
+
+    // fills the visible lists with everything whose sprite can overlap the view, each sorted back to front
+    void collectVisible(const RenderSnapshot& snapshot, sf::FloatRect visible, float age);
+    // merges the structures from middle on, already sorted, into the sorted ones before them
+    void mergeStructures(size_t middle);
+    // back to front, stable so soldiers on the same y keep the order they were collected in
+    void sortSoldiers();
+    void drawStructure(SpriteBatch& batch, const StructureSprite& structure);
+    void drawSoldier(SpriteBatch& batch, const SoldierSprite& soldier, float age);
+
+    GroundLayer m_Ground;
+
+    // structures come sorted per chunk from the snapshot and only get merged, soldiers move and are sorted
+    // every frame. drawing merges the two lists
+    std::vector<const StructureSprite *> m_VisibleStructures;
+    std::vector<const StructureSprite *> m_MergeScratch;
+    // y to sort by and the index of the soldier in the snapshot
+    std::vector<std::pair<float, uint32_t>> m_VisibleSoldiers;
+    std::vector<std::pair<float, uint32_t>> m_SortScratch;
+    std::vector<size_t> m_SortRows;
 };
@@ -0,0 +1,259 @@
+#include "RenderBench.h"
+#include "ClientGameState.h"
+#include "InterpolatedPosition.h"
+#include "Map.h"
+#include "RenderSnapshot.h"
+#include "WallMask.h"
+#include "Renderer/Renderer.h"
+#include "Server/Farm.h"
+#include "Server/Soldier.h"
+#include "Utils/AssetPack.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Timers.h"
+#include "logy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr double FRAME_TIME = 1.0 / 60.0;
+// the server replicates 20 times a second, a new snapshot every third frame
+constexpr uint32_t FRAMES_PER_SNAPSHOT = 3;
+constexpr uint32_t CASTLE_EVERY = 50;
+// how far a soldier walks between snapshots, in pixels
+constexpr float SOLDIER_STEP = 8.f;
+
+struct Summary {
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+Summary summarize(std::vector<double> samples) {
+    Summary summary;
+    if (samples.empty()) return summary;
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+    };
+
+    for (double sample: samples) summary.mean += sample;
+    summary.mean /= static_cast<double>(samples.size());
+    summary.p50 = percentile(0.5);
+    summary.p90 = percentile(0.9);
+    summary.p99 = percentile(0.99);
+    summary.max = samples.back();
+    return summary;
+}
+
+void printSummary(const char *name, const Summary& summary, bool last) {
+    std::printf("  \"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+                name, summary.mean, summary.p50, summary.p90, summary.p99, summary.max, last ? "" : ",");
+}
+
+bool isFree(const MapInfo& mapInfo, int x, int y, int size) {
+    for (int tileY = y; tileY < y + size; tileY++) {
+        for (int tileX = x; tileX < x + size; tileX++) {
+            if (!mapInfo.inBounds(tileX, tileY) || mapInfo.structureAt(tileX, tileY) != entt::null) return false;
+        }
+    }
+    return true;
+}
+
+// four players owning a quadrant each, so walls only connect within a quadrant like in a real match
+ID_t ownerAt(const MapInfo& mapInfo, int x, int y) {
+    int half = static_cast<int>(mapInfo.size) / 2;
+    return (x < half ? 0 : 1) + (y < half ? 0 : 2);
+}
+
+void place(ClientGameState& state, StructureType type, int x, int y, int size) {
+    entt::registry& registry = state.registry;
+
+    entt::entity entity = registry.create();
+    registry.emplace<Structure>(entity, Structure{ type, x, y, size, ownerAt(state.mapInfo, x, y) });
+    if (type == FARM) registry.emplace<Farm>(entity, Farm{ (x + y) % 3 == 0 ? HARVEST : GROWING });
+
+    for (int tileY = y; tileY < y + size; tileY++) {
+        for (int tileX = x; tileX < x + size; tileX++) state.mapInfo.setStructure(tileX, tileY, entity);
+    }
+}
+}
+
+bool RenderBench::run() {
+    const Config& config = m_Config;
+    if (config.frames == 0 || config.mapSize == 0 || config.width == 0 || config.height == 0) {
+        LOG_WARNING("Render bench needs at least one frame, a map and a target size");
+        return false;
+    }
+
+#if defined(__unix__)
+    // mesa's software rasterizer, so runs on different machines compare. an explicit setting wins
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+#endif
+
+    Utils::AssetPack assets;
+    if (!assets.open("assets.pak") && !assets.openDirectory("assets")) {
+        LOG_WARNING("Render bench found neither assets.pak nor the assets directory");
+        return false;
+    }
+
+    // the renderer keeps a reference to its title
+    const std::string title = "render bench";
+    Renderer renderer(title);
+    if (!renderer.initOffscreen(assets, { config.width, config.height })) {
+        LOG_WARNING("Failed to create a", config.width, "x", config.height,
+                    "offscreen target, rendering needs an OpenGL context (an X display on Linux, try xvfb-run)");
+        return false;
+    }
+    renderer.update();
+
+    Map map;
+    {
+        Utils::JobSystem jobs;
+        map.load(assets, jobs);
+    }
+
+    ClientGameState state;
+    state.gameStage = GAME;
+    state.mapInfo.size = config.mapSize;
+    state.mapInfo.init();
+    entt::registry& registry = state.registry;
+
+    std::mt19937 random(config.seed);
+    const int mapSize = static_cast<int>(config.mapSize);
+    std::uniform_int_distribution<int> randomTile(0, mapSize - 1);
+
+    // a bounded number of attempts each, a crowded map just ends up with fewer
+    uint32_t structures = 0;
+    for (uint32_t attempt = 0; attempt < config.structures * 4 && structures < config.structures; attempt++) {
+        bool castle = structures % CASTLE_EVERY == 0;
+        int size = castle ? 3 : 1;
+        int x = randomTile(random);
+        int y = randomTile(random);
+        if (!isFree(state.mapInfo, x, y, size)) continue;
+
+        place(state, castle ? CASTLE : FARM, x, y, size);
+        structures++;
+    }
+
+    // fences of a few tiles in a row, touching each other now and then
+    uint32_t walls = 0;
+    std::uniform_int_distribution<int> randomLength(3, 12);
+    for (uint32_t attempt = 0; attempt < config.walls * 4 && walls < config.walls; attempt++) {
+        int x = randomTile(random);
+        int y = randomTile(random);
+        bool horizontal = random() % 2 == 0;
+
+        for (int length = randomLength(random); length > 0 && walls < config.walls; length--) {
+            if (!isFree(state.mapInfo, x, y, 1)) break;
+
+            place(state, WALL, x, y, 1);
+            walls++;
+            if (horizontal) x++;
+            else y++;
+        }
+    }
+
+    for (auto [entity, structure]: registry.view<Structure>().each()) {
+        if (structure.type == WALL) {
+            registry.emplace<WallMask>(entity, wallNeighbourMask(state.mapInfo, registry, structure));
+        }
+    }
+
+    const float mapPixels = static_cast<float>(config.mapSize) * 32.f;
+    std::uniform_real_distribution<float> randomPixel(0.f, mapPixels - 1.f);
+    std::uniform_real_distribution<float> randomStep(-SOLDIER_STEP, SOLDIER_STEP);
+    for (uint32_t i = 0; i < config.soldiers; i++) {
+        entt::entity entity = registry.create();
+        float x = randomPixel(random);
+        float y = randomPixel(random);
+        ID_t owner = ownerAt(state.mapInfo, static_cast<int>(x / 32), static_cast<int>(y / 32));
+        registry.emplace<Soldier>(entity, Soldier(owner, SoldierType::Basic, 32.f));
+        registry.emplace<InterpolatedPosition>(entity, x, y, 0.15f, 0.0);
+    }
+
+    // sweeps back and forth over the map, or stays centred when the view covers it
+    sf::Vector2f halfView = renderer.viewMain().getSize() / 2.f;
+    auto sweep = [mapPixels](double phase, float half) {
+        if (mapPixels <= 2 * half) return mapPixels / 2;
+        return half + (mapPixels - 2 * half) * static_cast<float>(0.5 - 0.5 * std::cos(phase));
+    };
+
+    std::vector<double> frameTimes;
+    std::vector<double> snapshotTimes;
+    std::vector<double> drawCalls;
+    std::vector<double> quads;
+    std::vector<double> visible;
+    frameTimes.reserve(config.frames);
+    drawCalls.reserve(config.frames);
+    quads.reserve(config.frames);
+    visible.reserve(config.frames);
+
+    RenderSnapshot snapshot;
+    SpriteBatch& batch = renderer.batch();
+    double now = 0.0;
+
+    Utils::Timers::Stopwatch total;
+    for (uint32_t frame = 0; frame < config.warmupFrames + config.frames; frame++) {
+        bool measured = frame >= config.warmupFrames;
+        if (frame == config.warmupFrames) total.lap();
+
+        if (frame % FRAMES_PER_SNAPSHOT == 0) {
+            for (auto [entity, position]: registry.view<InterpolatedPosition>().each()) {
+                position.set(std::clamp(position.targetX + randomStep(random), 0.f, mapPixels - 1.f),
+                             std::clamp(position.targetY + randomStep(random), 0.f, mapPixels - 1.f), now);
+            }
+
+            Utils::Timers::Stopwatch stopwatch;
+            snapshot.build(state, 0, false, now);
+            if (measured) snapshotTimes.push_back(stopwatch.lap());
+        }
+
+        renderer.viewMain().setCenter({ sweep(frame * 0.011, halfView.x), sweep(frame * 0.007, halfView.y) });
+        batch.resetStats();
+
+        Utils::Timers::Stopwatch stopwatch;
+        renderer.target().clear(sf::Color::Black);
+        map.render(FRAME_TIME, renderer, snapshot, now);
+        renderer.display();
+        double frameTime = stopwatch.lap();
+
+        now += FRAME_TIME;
+        if (!measured) continue;
+
+        frameTimes.push_back(frameTime);
+        drawCalls.push_back(batch.drawCalls() + map.groundDrawCalls());
+        quads.push_back(batch.quads());
+        visible.push_back(static_cast<double>(map.visibleCount()));
+    }
+
+    // the frame times are what the cpu spent submitting, reading the last frame back waits for the gpu to
+    // finish everything so the frame rate includes its work too
+    [[maybe_unused]] sf::Image lastFrame = renderer.offscreen().getTexture().copyToImage();
+    double seconds = total.lap() / 1000.0;
+
+    std::printf("{\n");
+    std::printf("  \"config\": { \"structures\": %u, \"walls\": %u, \"soldiers\": %u, \"frames\": %u, "
+                "\"warmup_frames\": %u, \"map_size\": %u, \"width\": %u, \"height\": %u, \"seed\": %u },\n",
+                config.structures, config.walls, config.soldiers, config.frames, config.warmupFrames,
+                config.mapSize, config.width, config.height, config.seed);
+    std::printf("  \"entities\": { \"structures\": %u, \"walls\": %u, \"soldiers\": %u },\n",
+                structures, walls, config.soldiers);
+    std::printf("  \"frames_per_second\": %.2f,\n", config.frames / seconds);
+    printSummary("frame_ms", summarize(std::move(frameTimes)), false);
+    printSummary("draw_calls", summarize(std::move(drawCalls)), false);
+    printSummary("sprites", summarize(std::move(quads)), false);
+    printSummary("visible", summarize(std::move(visible)), false);
+    printSummary("snapshot_ms", summarize(std::move(snapshotTimes)), true);
+    std::printf("}\n");
+
+    return true;
+}
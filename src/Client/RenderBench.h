@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// renders a synthetic map into an offscreen texture and prints frame timings and draw calls as json to stdout,
+// so rendering can be measured without a window or anyone watching it. the camera pans across the map and the
+// soldiers keep walking, snapshots are rebuilt at the server's update rate like the network thread would
+class RenderBench {
+public:
+    struct Config {
+        // farms, with a castle every CASTLE_EVERY of them
+        uint32_t structures = 2000;
+        uint32_t walls = 4000;
+        uint32_t soldiers = 5000;
+        uint32_t frames = 600;
+        // not measured, bakes the ground under the first views and grows the batch
+        uint32_t warmupFrames = 30;
+        // in tiles per side
+        uint32_t mapSize = 128;
+        uint32_t width = 1920;
+        uint32_t height = 1080;
+        uint32_t seed = 1;
+    };
+
+    explicit RenderBench(const Config& config) : m_Config(config) {}
+
+    // false when there's no OpenGL to render with or the assets are missing
+    bool run();
+
+private:
+    Config m_Config;
+};
@@ -0,0 +1,158 @@
+#include "RenderSnapshot.h"
+#include "ClientGameState.h"
+#include "InterpolatedPosition.h"
+#include "WallMask.h"
+#include "Server/Farm.h"
+#include "Server/Soldier.h"
+
+#include <algorithm>
+#include <cmath>
+
+void RenderSnapshot::build(const ClientGameState& state, ID_t selfId, bool isLockstep, double now) {
+    const entt::registry& registry = state.registry;
+
+    time = now;
+    gameStage = state.gameStage;
+    self = selfId;
+    lockstep = isLockstep;
+
+    // the names are strings, copying them with every snapshot would cost more than the rest of the lobby
+    if (playersRevision != state.playersRevision) {
+        players = state.players;
+        playersRevision = state.playersRevision;
+    }
+    auto you = state.players.find(selfId);
+    gold = you != state.players.end() ? you->second.gold : 0;
+
+    // a new map, nothing copied from the old one is any use
+    if (mapSize != state.mapInfo.size || chunksPerSide != state.mapInfo.chunksPerSide()) {
+        mapSize = state.mapInfo.size;
+        chunksPerSide = state.mapInfo.chunksPerSide();
+        chunks.clear();
+        chunks.resize(static_cast<size_t>(chunksPerSide) * chunksPerSide);
+    }
+
+    maxStructureSize = 1;
+    for (uint32_t chunk = 0; chunk < chunks.size(); chunk++) {
+        if (chunks[chunk].revision != state.chunkRevision(chunk)) buildChunk(state, chunk);
+        maxStructureSize = std::max(maxStructureSize, chunks[chunk].maxSize);
+    }
+
+    // soldiers move all the time, they're counting sorted by culling cell with every build
+    cellsPerSide = static_cast<uint32_t>(std::ceil(static_cast<float>(mapSize) * 32 / SOLDIER_CELL_SIZE));
+    int lastCell = static_cast<int>(cellsPerSide) - 1;
+    auto cellOf = [lastCell, this](float x, float y) {
+        // soldiers walking off the map stay in the border cells
+        int column = std::clamp(static_cast<int>(std::floor(x / SOLDIER_CELL_SIZE)), 0, lastCell);
+        int row = std::clamp(static_cast<int>(std::floor(y / SOLDIER_CELL_SIZE)), 0, lastCell);
+        return static_cast<uint32_t>(row) * cellsPerSide + static_cast<uint32_t>(column);
+    };
+
+    auto soldierView = registry.view<const Soldier, const InterpolatedPosition>();
+    cellStarts.assign(static_cast<size_t>(cellsPerSide) * cellsPerSide + 1, 0);
+    if (cellsPerSide > 0) {
+        for (auto [entity, soldier, position]: soldierView.each()) {
+            cellStarts[cellOf(position.targetX, position.targetY) + 1]++;
+        }
+    }
+    for (size_t i = 1; i < cellStarts.size(); i++) cellStarts[i] += cellStarts[i - 1];
+
+    soldiers.resize(cellStarts.back());
+    m_Cursors.assign(cellStarts.begin(), cellStarts.end() - 1);
+    if (cellsPerSide > 0) {
+        for (auto [entity, soldier, position]: soldierView.each()) {
+            float remaining = static_cast<float>(position.start - now) + position.interpolateTime;
+            soldiers[m_Cursors[cellOf(position.targetX, position.targetY)]++] = SoldierSprite{
+                    position.x(now), position.y(now), position.targetX, position.targetY,
+                    std::max(remaining, 0.f), soldier.size
+            };
+        }
+    }
+}
+
+void RenderSnapshot::buildChunk(const ClientGameState& state, uint32_t chunk) {
+    const entt::registry& registry = state.registry;
+    StructureChunk& target = chunks[chunk];
+    target.structures.clear();
+    target.maxSize = 0;
+    target.revision = state.chunkRevision(chunk);
+
+    const MapChunk *mapChunk = state.mapInfo.chunk(chunk);
+    if (!mapChunk) return;
+
+    int originX = static_cast<int>(chunk % chunksPerSide) * MAP_CHUNK_SIZE;
+    int originY = static_cast<int>(chunk / chunksPerSide) * MAP_CHUNK_SIZE;
+
+    // structures cover several tiles, only the one on their top left tile is taken
+    for (int i = 0; i < MAP_CHUNK_SIZE * MAP_CHUNK_SIZE; i++) {
+        entt::entity entity = mapChunk->structures[i];
+        if (entity == entt::null) continue;
+
+        const auto& structure = registry.get<Structure>(entity);
+        if (structure.x != originX + i % MAP_CHUNK_SIZE || structure.y != originY + i / MAP_CHUNK_SIZE) continue;
+
+        uint8_t spriteState = 0;
+        if (structure.type == FARM) {
+            if (const auto *farm = registry.try_get<Farm>(entity)) spriteState = farm->state;
+        } else if (structure.type == WALL) {
+            if (const auto *wallMask = registry.try_get<WallMask>(entity)) spriteState = wallMask->mask;
+        }
+
+        const auto *networkId = registry.try_get<NetworkID>(entity);
+        target.structures.push_back(StructureSprite{
+                structure.x, structure.y, structure.size, structure.type, spriteState,
+                networkId ? *networkId : NetworkID{}
+        });
+        target.maxSize = std::max(target.maxSize, structure.size);
+    }
+
+    // the tiles are scanned row by row, only structures taller than a tile end up out of order
+    std::stable_sort(target.structures.begin(), target.structures.end(), [](const auto& a, const auto& b) {
+        return a.sortY() < b.sortY();
+    });
+}
+
+const StructureSprite *RenderSnapshot::structureAt(int x, int y) const {
+    if (!inBounds(x, y)) return nullptr;
+
+    // the structure can start in a chunk up or left of the tile's
+    int lastChunk = static_cast<int>(chunksPerSide) - 1;
+    int fromX = std::max(0, (x - maxStructureSize + 1) / MAP_CHUNK_SIZE);
+    int fromY = std::max(0, (y - maxStructureSize + 1) / MAP_CHUNK_SIZE);
+    int toX = std::min(lastChunk, x / MAP_CHUNK_SIZE);
+    int toY = std::min(lastChunk, y / MAP_CHUNK_SIZE);
+
+    for (int chunkY = fromY; chunkY <= toY; chunkY++) {
+        for (int chunkX = fromX; chunkX <= toX; chunkX++) {
+            size_t chunk = static_cast<size_t>(chunkY) * chunksPerSide + chunkX;
+            for (const StructureSprite& structure: chunks[chunk].structures) {
+                if (x >= structure.x && x < structure.x + structure.size &&
+                    y >= structure.y && y < structure.y + structure.size) {
+                    return &structure;
+                }
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void SnapshotBuffer::publish() {
+    std::lock_guard guard(m_Mutex);
+    std::swap(m_Back, m_Ready);
+    m_Fresh = true;
+}
+
+bool SnapshotBuffer::consumed() {
+    std::lock_guard guard(m_Mutex);
+    return !m_Fresh;
+}
+
+const RenderSnapshot& SnapshotBuffer::acquire() {
+    std::lock_guard guard(m_Mutex);
+    if (m_Fresh) {
+        std::swap(m_Front, m_Ready);
+        m_Fresh = false;
+    }
+    return *m_Front;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "NetworkEntityMap.h"
+#include "Server/ServerGameState.h"
+#include "Server/Structure.h"
+
+struct ClientGameState;
+
+// a structure as the renderer sees it
+struct StructureSprite {
+    int x;
+    int y;
+    int size;
+    StructureType type;
+    // the neighbour mask of a wall, the FarmState of a farm
+    uint8_t state;
+    NetworkID id;
+
+    // drawn back to front by their bottom edge, in pixels
+    [[nodiscard]] float sortY() const { return static_cast<float>(32 * (y + size)); }
+};
+
+// a soldier moving from one point to another, reaching it arrival seconds after the snapshot was taken
+struct SoldierSprite {
+    float fromX;
+    float fromY;
+    float toX;
+    float toY;
+    float arrival;
+    float size;
+
+    // age is how many seconds ago the snapshot was taken
+    [[nodiscard]] float progress(float age) const { return arrival > age ? age / arrival : 1.f; }
+    [[nodiscard]] float x(float age) const { return fromX + (toX - fromX) * progress(age); }
+    [[nodiscard]] float y(float age) const { return fromY + (toY - fromY) * progress(age); }
+};
+
+// the structures starting in one map chunk
+struct StructureChunk {
+    // sorted back to front when the chunk is copied, structures don't move so the order holds until it changes
+    std::vector<StructureSprite> structures;
+    // in tiles, of the biggest of them
+    int maxSize = 0;
+    // of the chunk in the game state when they were copied
+    uint32_t revision = 0;
+};
+
+// everything a frame needs, copied out of the client's registry by the network thread so the renderer never
+// touches the registry. structures are grouped by the map chunk of their top left tile and soldiers by culling
+// cell, so culling walks a few contiguous ranges
+struct RenderSnapshot {
+    static constexpr float SOLDIER_CELL_SIZE = 128.f;
+
+    // seconds on the client clock when it was taken
+    double time = 0.0;
+
+    GameStage gameStage = LOBBY;
+    ID_t self = ID_t_MAX;
+    bool lockstep = false;
+    // only copied when playersRevision moved
+    std::unordered_map<ID_t, ServerPlayerInfo> players;
+    uint32_t playersRevision = 0;
+    // of self, changes without a players revision
+    int gold = 0;
+
+    uint32_t mapSize = 0;
+    uint32_t chunksPerSide = 0;
+    // in tiles, how far up and left of a chunk a structure reaching into it can start
+    int maxStructureSize = 1;
+
+    // row by row, only the chunks that changed since this snapshot was last built are copied again
+    std::vector<StructureChunk> chunks;
+
+    // the soldiers of cell i are [cellStarts[i], cellStarts[i + 1]), bucketed by where they're heading
+    uint32_t cellsPerSide = 0;
+    std::vector<SoldierSprite> soldiers;
+    std::vector<uint32_t> cellStarts;
+
+    // brings the snapshot up to date with the state. players and structure chunks are only copied when their
+    // revision moved, soldiers are copied every time
+    void build(const ClientGameState& state, ID_t selfId, bool isLockstep, double now);
+
+    [[nodiscard]] bool inBounds(int x, int y) const {
+        return x >= 0 && y >= 0 && x < static_cast<int>(mapSize) && y < static_cast<int>(mapSize);
+    }
+
+    // the structure covering the tile, null if there's none
+    [[nodiscard]] const StructureSprite *structureAt(int x, int y) const;
+
+    [[nodiscard]] const ServerPlayerInfo *player(ID_t id) const {
+        auto it = players.find(id);
+        return it != players.end() ? &it->second : nullptr;
+    }
+
+private:
+    void buildChunk(const ClientGameState& state, uint32_t chunk);
+
+    std::vector<uint32_t> m_Cursors;
+};
+
+// hands snapshots from the network thread to the renderer. the writer fills one while the reader draws another
+// and a third holds the latest finished one, so neither side waits for the other. the snapshots keep their
+// memory and contents, building one again only copies what changed since it was last built
+class SnapshotBuffer {
+public:
+    // only the writer touches it, until publish()
+    RenderSnapshot& back() { return *m_Back; }
+    void publish();
+
+    // the reader took the latest published snapshot, one built before it does would never be drawn
+    [[nodiscard]] bool consumed();
+
+    // the latest published snapshot, only the reader touches it until the next call
+    const RenderSnapshot& acquire();
+
+private:
+    std::array<RenderSnapshot, 3> m_Snapshots;
+    RenderSnapshot *m_Back = &m_Snapshots[0];
+    RenderSnapshot *m_Ready = &m_Snapshots[1];
+    RenderSnapshot *m_Front = &m_Snapshots[2];
+    bool m_Fresh = false;
+    std::mutex m_Mutex;
+};
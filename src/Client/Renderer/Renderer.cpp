@@ -9,9 +9,23 @@ Renderer::~Renderer() {
 
 }
 
-void Renderer::init() {
+void Renderer::init(const Utils::AssetPack& assets) {
     m_RenderWindow.create(sf::VideoMode({ 1920, 1080 }), m_Title, sf::Style::Default);
-    if (!m_Font.openFromFile("assets/Arial.ttf")) {
+    loadFont(assets);
+}
+
+bool Renderer::initOffscreen(const Utils::AssetPack& assets, sf::Vector2u size) {
+    if (!m_RenderTexture.resize(size)) return false;
+
+    m_Target = &m_RenderTexture;
+    m_Batch.setTarget(m_RenderTexture);
+    loadFont(assets);
+    return true;
+}
+
+void Renderer::loadFont(const Utils::AssetPack& assets) {
+    std::span<const char> font = assets.get("Arial.ttf");
+    if (font.empty() || !m_Font.openFromMemory(font.data(), font.size())) {
         throw std::runtime_error("Failed to load font");
     }
 }
@@ -20,7 +34,7 @@ void Renderer::update() {
     constexpr float VIEW_HEIGHT = 1000.f;
 
     sf::Vector2f viewSize = {
-            static_cast<float>(m_RenderWindow.getSize().x) / static_cast<float>(m_RenderWindow.getSize().y) * VIEW_HEIGHT,
+            static_cast<float>(m_Target->getSize().x) / static_cast<float>(m_Target->getSize().y) * VIEW_HEIGHT,
             VIEW_HEIGHT
     };
 
@@ -28,4 +42,9 @@ void Renderer::update() {
     m_MainView.setSize(viewSize);
 }
 
+void Renderer::display() {
+    if (m_Target == &m_RenderTexture) m_RenderTexture.display();
+    else m_RenderWindow.display();
+}
+
 
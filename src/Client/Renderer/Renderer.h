@@ -1,6 +1,8 @@
 #pragma once
 
 #include "SFML/Graphics.hpp"
+#include "SpriteBatch.h"
+#include "Utils/AssetPack.h"
 
 class Renderer {
 public:
@@ -11,14 +13,33 @@ public:
         return m_RenderWindow;
     }
 
+    // where everything is drawn, the window or the offscreen texture
+    sf::RenderTarget& target() {
+        return *m_Target;
+    }
+
+    const sf::RenderTexture& offscreen() const {
+        return m_RenderTexture;
+    }
+
     sf::Font &font() {
         return m_Font;
     }
 
-    void init();
+    // draws into the target, flush it before changing the view
+    SpriteBatch& batch() {
+        return m_Batch;
+    }
+
+    // the font reads from the pack for as long as it's used, so the pack has to outlive the renderer
+    void init(const Utils::AssetPack& assets);
+    // renders into a texture of that size instead of opening a window, for benchmarks. false when no OpenGL
+    // context could be made for it
+    bool initOffscreen(const Utils::AssetPack& assets, sf::Vector2u size);
     void update();
+    void display();
 
-    void setViewUI() { m_RenderWindow.setView(m_UiView); }
+    void setViewUI() { m_Target->setView(m_UiView); }
     [[nodiscard]] sf::Vector2f uiTopLeft() const { return m_UiView.getCenter() - m_UiView.getSize() / 2.f; }
     [[nodiscard]] sf::Vector2f uiBottomRight() const { return m_UiView.getCenter() + m_UiView.getSize() / 2.f; }
     [[nodiscard]] sf::Vector2f uiTopRight() const { return m_UiView.getCenter() + sf::Vector2f(-m_UiView.getSize().x / 2.f, m_UiView.getSize().y / 2.f); }
@@ -29,13 +50,18 @@ public:
     [[nodiscard]] sf::Vector2f uiRightCenter() const { return m_UiView.getCenter() + sf::Vector2f(m_UiView.getSize().x / 2.f, 0); }
     [[nodiscard]] sf::Vector2f uiCenter() const { return m_UiView.getCenter(); }
 
-    void setViewMain() { m_RenderWindow.setView(m_MainView); }
+    void setViewMain() { m_Target->setView(m_MainView); }
     sf::View &viewMain() { return m_MainView; }
     sf::View &viewUI() { return m_UiView; }
 private:
     const std::string &m_Title;
 
+    void loadFont(const Utils::AssetPack& assets);
+
     sf::RenderWindow m_RenderWindow;
+    sf::RenderTexture m_RenderTexture;
+    sf::RenderTarget *m_Target = &m_RenderWindow;
+    SpriteBatch m_Batch{ m_RenderWindow };
     sf::View m_UiView;
     sf::View m_MainView;
 
@@ -0,0 +1,54 @@
+#include "SpriteBatch.h"
+
+void SpriteBatch::draw(const AtlasRegion& region, sf::Vector2f position, sf::Vector2f origin, sf::Vector2f scale,
+                       sf::Color color) {
+    draw(region, { { 0, 0 }, region.rect.size }, position, origin, scale, color);
+}
+
+void SpriteBatch::draw(const AtlasRegion& region, sf::IntRect part, sf::Vector2f position, sf::Vector2f origin,
+                       sf::Vector2f scale, sf::Color color) {
+    sf::Vector2f size(part.size);
+    sf::FloatRect bounds(position - origin.componentWiseMul(scale), size.componentWiseMul(scale));
+    sf::FloatRect uv(sf::Vector2f(region.rect.position + part.position), size);
+
+    quad(region.texture, bounds, uv, color);
+}
+
+void SpriteBatch::rect(sf::FloatRect rect, sf::Color color) {
+    quad(nullptr, rect, {}, color);
+}
+
+void SpriteBatch::quad(const sf::Texture *texture, sf::FloatRect bounds, sf::FloatRect uv, sf::Color color) {
+    if (texture != m_Texture) {
+        flush();
+        m_Texture = texture;
+    }
+
+    sf::Vector2f topLeft = bounds.position;
+    sf::Vector2f bottomRight = bounds.position + bounds.size;
+    sf::Vector2f uvTopLeft = uv.position;
+    sf::Vector2f uvBottomRight = uv.position + uv.size;
+
+    size_t index = m_Vertices.size();
+    m_Vertices.resize(index + 6);
+    sf::Vertex *vertices = m_Vertices.data() + index;
+
+    vertices[0] = { topLeft, color, uvTopLeft };
+    vertices[1] = { { bottomRight.x, topLeft.y }, color, { uvBottomRight.x, uvTopLeft.y } };
+    vertices[2] = { { topLeft.x, bottomRight.y }, color, { uvTopLeft.x, uvBottomRight.y } };
+    vertices[3] = vertices[2];
+    vertices[4] = vertices[1];
+    vertices[5] = { bottomRight, color, uvBottomRight };
+
+    m_Quads++;
+}
+
+void SpriteBatch::flush() {
+    if (m_Vertices.empty()) return;
+
+    sf::RenderStates states(m_Texture);
+    m_Target->draw(m_Vertices.data(), m_Vertices.size(), sf::PrimitiveType::Triangles, states);
+
+    m_Vertices.clear();
+    m_DrawCalls++;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "SFML/Graphics.hpp"
+#include "TextureAtlas.h"
+
+// collects textured quads and draws them with as few draw calls as possible. quads are drawn in the order they
+// were added, a new draw call only starts when the texture changes, so sprites from one atlas page all end up
+// in the same one. the target's view has to stay the same until flush()
+class SpriteBatch {
+public:
+    explicit SpriteBatch(sf::RenderTarget& target) : m_Target(&target) {}
+
+    // flush() first, quads already added would end up on the new target
+    void setTarget(sf::RenderTarget& target) { m_Target = &target; }
+
+    // origin and scale work like they do for sf::Sprite, the origin is in unscaled pixels
+    void draw(const AtlasRegion& region, sf::Vector2f position, sf::Vector2f origin = {},
+              sf::Vector2f scale = { 1.f, 1.f }, sf::Color color = sf::Color::White);
+    // part of the region, relative to its top left corner, for sprite sheets
+    void draw(const AtlasRegion& region, sf::IntRect part, sf::Vector2f position, sf::Vector2f origin = {},
+              sf::Vector2f scale = { 1.f, 1.f }, sf::Color color = sf::Color::White);
+    // untextured
+    void rect(sf::FloatRect rect, sf::Color color);
+
+    void flush();
+
+    // since the last resetStats()
+    [[nodiscard]] uint32_t drawCalls() const { return m_DrawCalls; }
+    [[nodiscard]] uint32_t quads() const { return m_Quads; }
+    void resetStats() { m_DrawCalls = m_Quads = 0; }
+
+private:
+    void quad(const sf::Texture *texture, sf::FloatRect bounds, sf::FloatRect uv, sf::Color color);
+
+    sf::RenderTarget *m_Target;
+
+    const sf::Texture *m_Texture = nullptr;
+    // kept between flushes so a frame doesn't allocate once the batch has grown to fit it
+    std::vector<sf::Vertex> m_Vertices;
+
+    uint32_t m_DrawCalls = 0;
+    uint32_t m_Quads = 0;
+};
@@ -0,0 +1,112 @@
+#include "TextureAtlas.h"
+#include "logy.h"
+
+#include <algorithm>
+
+namespace {
+// every image is surrounded by a copy of its own edge pixels, so neighbours never bleed into it when scaled
+constexpr unsigned PADDING = 1;
+
+void blit(sf::Image& page, const sf::Image& image, sf::Vector2u corner) {
+    sf::Vector2u size = image.getSize();
+    for (unsigned y = 0; y < size.y + 2 * PADDING; y++) {
+        unsigned sourceY = std::clamp(static_cast<int>(y) - static_cast<int>(PADDING), 0,
+                                      static_cast<int>(size.y) - 1);
+        for (unsigned x = 0; x < size.x + 2 * PADDING; x++) {
+            unsigned sourceX = std::clamp(static_cast<int>(x) - static_cast<int>(PADDING), 0,
+                                          static_cast<int>(size.x) - 1);
+            page.setPixel({ corner.x + x, corner.y + y }, image.getPixel({ sourceX, sourceY }));
+        }
+    }
+}
+}
+
+bool TextureAtlas::add(const std::string& name, const std::filesystem::path& path) {
+    sf::Image image;
+    if (!image.loadFromFile(path)) {
+        LOG_WARNING("Failed to load texture", path.string());
+        add(name, sf::Image({ 32, 32 }, sf::Color::Transparent));
+        return false;
+    }
+
+    add(name, std::move(image));
+    return true;
+}
+
+void TextureAtlas::add(const std::string& name, sf::Image image) {
+    if (image.getSize().x == 0 || image.getSize().y == 0) image = sf::Image({ 1, 1 }, sf::Color::Transparent);
+    m_Pending.push_back({ name, std::move(image) });
+}
+
+void TextureAtlas::pack(unsigned pageSize) {
+    // tallest first keeps the shelves from wasting space above short images
+    std::sort(m_Pending.begin(), m_Pending.end(), [](const Pending& a, const Pending& b) {
+        if (a.image.getSize().y != b.image.getSize().y) return a.image.getSize().y > b.image.getSize().y;
+        return a.image.getSize().x > b.image.getSize().x;
+    });
+
+    struct Page {
+        sf::Image image;
+        // what is actually used, the texture is cropped to it
+        sf::Vector2u extent;
+    };
+    std::vector<Page> pages;
+    std::vector<size_t> pageOf(m_Pending.size());
+
+    size_t current = SIZE_MAX;
+    unsigned shelfX = 0, shelfY = 0, shelfHeight = 0;
+
+    for (size_t i = 0; i < m_Pending.size(); i++) {
+        const sf::Image& image = m_Pending[i].image;
+        sf::Vector2u size = image.getSize() + sf::Vector2u(2 * PADDING, 2 * PADDING);
+        sf::Vector2u corner;
+
+        if (size.x > pageSize || size.y > pageSize) {
+            pages.push_back({ sf::Image(size, sf::Color::Transparent), size });
+            pageOf[i] = pages.size() - 1;
+            corner = { 0, 0 };
+        } else {
+            if (current != SIZE_MAX && shelfX + size.x > pageSize) {
+                shelfY += shelfHeight;
+                shelfX = 0;
+                shelfHeight = 0;
+            }
+
+            if (current == SIZE_MAX || shelfY + size.y > pageSize) {
+                pages.push_back({ sf::Image({ pageSize, pageSize }, sf::Color::Transparent), { 0, 0 } });
+                current = pages.size() - 1;
+                shelfX = shelfY = shelfHeight = 0;
+            }
+
+            corner = { shelfX, shelfY };
+            pageOf[i] = current;
+
+            shelfX += size.x;
+            shelfHeight = std::max(shelfHeight, size.y);
+
+            Page& page = pages[current];
+            page.extent = { std::max(page.extent.x, corner.x + size.x), std::max(page.extent.y, corner.y + size.y) };
+        }
+
+        blit(pages[pageOf[i]].image, image, corner);
+        m_Regions[m_Pending[i].name] = AtlasRegion{
+                .rect = { sf::Vector2i(corner + sf::Vector2u(PADDING, PADDING)), sf::Vector2i(image.getSize()) }
+        };
+    }
+
+    size_t firstPage = m_Pages.size();
+    for (const Page& page: pages) {
+        auto texture = std::make_unique<sf::Texture>();
+        if (!texture->loadFromImage(page.image, false, { { 0, 0 }, sf::Vector2i(page.extent) })) {
+            LOG_WARNING("Failed to create atlas page of", page.extent.x, "x", page.extent.y);
+        }
+        m_Pages.push_back(std::move(texture));
+    }
+
+    for (size_t i = 0; i < m_Pending.size(); i++) {
+        m_Regions[m_Pending[i].name].texture = m_Pages[firstPage + pageOf[i]].get();
+    }
+
+    LOG_INFO("Packed", m_Pending.size(), "textures into", pages.size(), "atlas pages");
+    m_Pending.clear();
+}
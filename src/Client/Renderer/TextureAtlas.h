@@ -0,0 +1,46 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SFML/Graphics.hpp"
+
+// where an image ended up in the atlas
+struct AtlasRegion {
+    const sf::Texture *texture = nullptr;
+    sf::IntRect rect;
+
+    [[nodiscard]] sf::Sprite sprite() const { return sf::Sprite(*texture, rect); }
+    // part of the region, for sprite sheets, relative to its top left corner
+    [[nodiscard]] sf::Sprite sprite(sf::IntRect part) const {
+        return sf::Sprite(*texture, { rect.position + part.position, part.size });
+    }
+};
+
+// packs images into as few textures as possible when the game loads, so sprites drawn one after another mostly
+// share a texture and can be batched
+class TextureAtlas {
+public:
+    // queues the image for pack(), an image that fails to load is replaced by a transparent tile
+    bool add(const std::string& name, const std::filesystem::path& path);
+    void add(const std::string& name, sf::Image image);
+
+    // shelf packs everything queued, images bigger than a page get a page of their own
+    void pack(unsigned pageSize = 2048);
+
+    // only valid after pack()
+    [[nodiscard]] const AtlasRegion& region(const std::string& name) const { return m_Regions.at(name); }
+    [[nodiscard]] size_t pageCount() const { return m_Pages.size(); }
+
+private:
+    struct Pending {
+        std::string name;
+        sf::Image image;
+    };
+
+    std::vector<Pending> m_Pending;
+    std::vector<std::unique_ptr<sf::Texture>> m_Pages;
+    std::unordered_map<std::string, AtlasRegion> m_Regions;
+};
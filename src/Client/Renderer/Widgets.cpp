@@ -0,0 +1,126 @@
+#include "Widgets.h"
+
+#include <cmath>
+
+namespace UI {
+void Container::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    states.transform *= getTransform();
+    for (const auto& child: m_Children) {
+        if (child->visible()) target.draw(*child, states);
+    }
+}
+
+Label::Label(const sf::Font& font, unsigned int size, sf::Vector2f position, sf::Vector2f anchor)
+        : m_Text(font, "", size), m_Anchor(anchor) {
+    m_Text.setPosition(position);
+    m_Text.setFillColor(m_Color);
+}
+
+void Label::setString(const std::string& string) {
+    if (string == m_String) return;
+
+    m_String = string;
+    m_Text.setString(m_String);
+    m_HasNumber = false;
+    updateOrigin();
+}
+
+void Label::setPrefix(std::string prefix) {
+    if (prefix == m_Prefix) return;
+
+    m_Prefix = std::move(prefix);
+    if (m_HasNumber) {
+        m_HasNumber = false;
+        setNumber(m_Number);
+    }
+}
+
+void Label::setNumber(int64_t number) {
+    if (m_HasNumber && number == m_Number) return;
+
+    setString(m_Prefix + std::to_string(number));
+    m_Number = number;
+    m_HasNumber = true;
+}
+
+void Label::setColor(sf::Color color) {
+    if (color == m_Color) return;
+
+    m_Color = color;
+    m_Text.setFillColor(color);
+}
+
+void Label::setStyle(uint32_t style) {
+    if (style == m_Style) return;
+
+    m_Style = style;
+    m_Text.setStyle(style);
+    updateOrigin();
+}
+
+void Label::updateOrigin() {
+    if (m_Anchor == sf::Vector2f{}) return;
+    m_Text.setOrigin(m_Text.getLocalBounds().size.componentWiseMul(m_Anchor));
+}
+
+void Label::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    target.draw(m_Text, states);
+}
+
+Box::Box(sf::FloatRect rect) : m_Shape(rect.size) {
+    m_Shape.setPosition(rect.position);
+    m_Shape.setFillColor(m_Fill);
+    m_Shape.setOutlineColor(m_Outline);
+}
+
+void Box::setFill(sf::Color color) {
+    if (color == m_Fill) return;
+
+    m_Fill = color;
+    m_Shape.setFillColor(color);
+}
+
+void Box::setOutline(sf::Color color, float thickness) {
+    if (color != m_Outline) {
+        m_Outline = color;
+        m_Shape.setOutlineColor(color);
+    }
+    // a new thickness rebuilds the outline, a new colour only recolours it
+    if (thickness != m_Thickness) {
+        m_Thickness = thickness;
+        m_Shape.setOutlineThickness(thickness);
+    }
+}
+
+void Box::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    target.draw(m_Shape, states);
+}
+
+void Image::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    target.draw(m_Sprite, states);
+}
+
+Grid::Grid(sf::Vector2f origin, sf::Vector2f cellSize, sf::Vector2f spacing, int columns, int count)
+        : m_Origin(origin), m_CellSize(cellSize), m_Pitch(cellSize + spacing), m_Columns(columns), m_Count(count) {}
+
+sf::FloatRect Grid::cell(int index) const {
+    sf::Vector2f position{ static_cast<float>(index % m_Columns) * m_Pitch.x,
+                           static_cast<float>(index / m_Columns) * m_Pitch.y };
+    return { m_Origin + position, m_CellSize };
+}
+
+int Grid::hit(sf::Vector2f point) const {
+    sf::Vector2f local = point - m_Origin;
+    if (local.x < 0.f || local.y < 0.f) return -1;
+
+    float column = std::floor(local.x / m_Pitch.x);
+    float row = std::floor(local.y / m_Pitch.y);
+    if (column >= static_cast<float>(m_Columns)) return -1;
+
+    // inside the pitch but past the cell is the gap to the next one
+    if (local.x - column * m_Pitch.x >= m_CellSize.x || local.y - row * m_Pitch.y >= m_CellSize.y) return -1;
+
+    int index = static_cast<int>(row) * m_Columns + static_cast<int>(column);
+    return index < m_Count ? index : -1;
+}
+}
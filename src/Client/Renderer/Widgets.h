@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SFML/Graphics.hpp"
+#include "TextureAtlas.h"
+
+// retained interface widgets. they're built once and keep their sfml objects between frames, the setters only
+// touch those when the value actually changed, so text geometry and shape outlines aren't rebuilt every frame
+namespace UI {
+class Widget : public sf::Drawable {
+public:
+    void setVisible(bool visible) { m_Visible = visible; }
+    [[nodiscard]] bool visible() const { return m_Visible; }
+
+private:
+    bool m_Visible = true;
+};
+
+// children are laid out relative to the container and drawn in the order they were added. moving the
+// container only changes the transform it draws them with
+class Container : public Widget, public sf::Transformable {
+public:
+    // the reference stays valid as long as the container
+    template<typename T, typename... Args>
+    T& add(Args&& ... args) {
+        m_Children.push_back(std::make_unique<T>(std::forward<Args>(args)...));
+        return static_cast<T&>(*m_Children.back());
+    }
+
+    void clear() { m_Children.clear(); }
+
+protected:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    std::vector<std::unique_ptr<Widget>> m_Children;
+};
+
+class Label : public Widget {
+public:
+    // anchor is the point of the text that sits on its position, as a fraction of its size
+    Label(const sf::Font& font, unsigned int size, sf::Vector2f position = {}, sf::Vector2f anchor = {});
+
+    void setString(const std::string& string);
+    // shown before the number, for labels bound to one
+    void setPrefix(std::string prefix);
+    // only formats the text when the number differs from the last one
+    void setNumber(int64_t number);
+    void setColor(sf::Color color);
+    void setStyle(uint32_t style);
+    void setPosition(sf::Vector2f position) { m_Text.setPosition(position); }
+
+    [[nodiscard]] const std::string& string() const { return m_String; }
+
+protected:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    void updateOrigin();
+
+    sf::Text m_Text;
+    std::string m_String;
+    std::string m_Prefix;
+    sf::Vector2f m_Anchor;
+    sf::Color m_Color = sf::Color::White;
+    uint32_t m_Style = sf::Text::Style::Regular;
+
+    int64_t m_Number = 0;
+    bool m_HasNumber = false;
+};
+
+class Box : public Widget {
+public:
+    explicit Box(sf::FloatRect rect);
+
+    void setFill(sf::Color color);
+    void setOutline(sf::Color color, float thickness);
+
+    [[nodiscard]] sf::FloatRect rect() const { return { m_Shape.getPosition(), m_Shape.getSize() }; }
+
+protected:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    sf::RectangleShape m_Shape;
+    sf::Color m_Fill = sf::Color::Transparent;
+    sf::Color m_Outline = sf::Color::Transparent;
+    float m_Thickness = 0.f;
+};
+
+class Image : public Widget {
+public:
+    explicit Image(const AtlasRegion& region) : m_Sprite(region.sprite()) {}
+    Image(const AtlasRegion& region, sf::IntRect part) : m_Sprite(region.sprite(part)) {}
+
+    // set up once after construction
+    sf::Sprite& sprite() { return m_Sprite; }
+
+protected:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    sf::Sprite m_Sprite;
+};
+
+// equally sized cells in rows with gaps between them. hit testing divides by the cell pitch instead of
+// checking a rect per cell
+class Grid {
+public:
+    // empty, nothing hits it
+    Grid() = default;
+    Grid(sf::Vector2f origin, sf::Vector2f cellSize, sf::Vector2f spacing, int columns, int count);
+
+    [[nodiscard]] sf::FloatRect cell(int index) const;
+    // the cell under the point, -1 outside the grid and in the gaps between cells
+    [[nodiscard]] int hit(sf::Vector2f point) const;
+
+    [[nodiscard]] int count() const { return m_Count; }
+
+private:
+    sf::Vector2f m_Origin;
+    sf::Vector2f m_CellSize;
+    sf::Vector2f m_Pitch{ 1.f, 1.f };
+    int m_Columns = 1;
+    int m_Count = 0;
+};
+}
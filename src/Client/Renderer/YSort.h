@@ -1,5 +0,0 @@
-#pragma once
-
-struct YSort {
-    float y;
-};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include "entt/entt.hpp"
+#include "Server/MapInfo.h"
+#include "Server/Structure.h"
+
+// which of the four neighbours are walls of the same owner, bits are up, right, down, left from high to low
+// and index the wall textures
+inline uint8_t wallNeighbourMask(const MapInfo& mapInfo, const entt::registry& registry, const Structure& wall) {
+    auto connects = [&](int x, int y) {
+        entt::entity neighbour = mapInfo.structureAt(x, y);
+        if (neighbour == entt::null) return false;
+
+        const auto& other = registry.get<Structure>(neighbour);
+        return other.type == WALL && other.owner == wall.owner;
+    };
+
+    uint8_t mask = 0;
+    if (connects(wall.x, wall.y - 1)) mask |= 0b1000;
+    if (connects(wall.x + 1, wall.y)) mask |= 0b0100;
+    if (connects(wall.x, wall.y + 1)) mask |= 0b0010;
+    if (connects(wall.x - 1, wall.y)) mask |= 0b0001;
+    return mask;
+}
+
+// the neighbour mask of a wall, kept up to date by updateWallMasks so drawing a wall doesn't look at its neighbours
+struct WallMask {
+    uint8_t mask;
+};
+
+// recomputes the masks of the wall on the tile and the walls around it, after a wall there was built or removed
+inline void updateWallMasks(const MapInfo& mapInfo, entt::registry& registry, int x, int y) {
+    auto update = [&](int tileX, int tileY) {
+        entt::entity entity = mapInfo.structureAt(tileX, tileY);
+        if (entity == entt::null) return;
+
+        const auto& structure = registry.get<Structure>(entity);
+        if (structure.type != WALL) return;
+
+        registry.emplace_or_replace<WallMask>(entity, wallNeighbourMask(mapInfo, registry, structure));
+    };
+
+    update(x, y);
+    update(x, y - 1);
+    update(x + 1, y);
+    update(x, y + 1);
+    update(x - 1, y);
+}
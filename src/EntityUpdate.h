@@ -0,0 +1,48 @@
+#pragma once
+
+#include "NetworkEntityMap.h"
+#include "Server/Structure.h"
+#include "Server/Farm.h"
+#include "Server/Soldier.h"
+#include "Server/Position.h"
+
+enum EntityUpdateFlags : uint8_t {
+    UPDATE_STRUCTURE_CREATED = 1 << 0,
+    UPDATE_FARM = 1 << 1,
+    UPDATE_SOLDIER_CREATED = 1 << 2,
+    UPDATE_POSITION = 1 << 3,
+    UPDATE_DELETED = 1 << 4,
+};
+
+// everything that changed about one networked entity during a tick, only the flagged parts are sent
+struct EntityUpdate {
+    NetworkID id;
+    uint8_t flags = 0;
+
+    Structure structure{};
+    Farm farm{};
+    Soldier soldier{};
+    Position position{};
+};
+
+inline sf::Packet& operator<<(sf::Packet& packet, const EntityUpdate& update) {
+    packet << update.id << update.flags;
+
+    if (update.flags & UPDATE_STRUCTURE_CREATED) packet << update.structure;
+    if (update.flags & UPDATE_FARM) packet << update.farm;
+    if (update.flags & UPDATE_SOLDIER_CREATED) packet << update.soldier;
+    if (update.flags & (UPDATE_SOLDIER_CREATED | UPDATE_POSITION)) packet << update.position;
+
+    return packet;
+}
+
+inline sf::Packet& operator>>(sf::Packet& packet, EntityUpdate& update) {
+    packet >> update.id >> update.flags;
+
+    if (update.flags & UPDATE_STRUCTURE_CREATED) packet >> update.structure;
+    if (update.flags & UPDATE_FARM) packet >> update.farm;
+    if (update.flags & UPDATE_SOLDIER_CREATED) packet >> update.soldier;
+    if (update.flags & (UPDATE_SOLDIER_CREATED | UPDATE_POSITION)) packet >> update.position;
+
+    return packet;
+}
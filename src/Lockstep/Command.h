@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include "SFML/Network/Packet.hpp"
+#include "Utils/Utils.h"
+#include "Fixed.h"
+
+enum CommandType : uint8_t {
+    COMMAND_PLACE_WALL,
+    COMMAND_PLANT_FARM,
+    COMMAND_SPAWN_SOLDIER,
+    COMMAND_HARVEST,
+};
+
+// a player action in lockstep mode, x and y are tiles except for soldiers where they are pixels
+struct Command {
+    CommandType type = COMMAND_PLACE_WALL;
+    ID_t player = 0;
+    Fixed x;
+    Fixed y;
+};
+
+inline sf::Packet& operator<<(sf::Packet& packet, const Command& command) {
+    return packet << static_cast<uint8_t>(command.type) << command.player << command.x << command.y;
+}
+
+inline sf::Packet& operator>>(sf::Packet& packet, Command& command) {
+    uint8_t type;
+    packet >> type >> command.player >> command.x >> command.y;
+    command.type = static_cast<CommandType>(type);
+    return packet;
+}
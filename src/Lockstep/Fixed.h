@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "SFML/Network/Packet.hpp"
+
+// 48.16 fixed point number, everything the lockstep simulation computes has to come out bit-identical on every
+// machine so floats only ever get converted at the edges (input and rendering)
+struct Fixed {
+    static constexpr int FRACTION_BITS = 16;
+    static constexpr int64_t ONE = int64_t(1) << FRACTION_BITS;
+
+    int64_t raw = 0;
+
+    constexpr Fixed() = default;
+
+    static constexpr Fixed fromRaw(int64_t raw) {
+        Fixed fixed;
+        fixed.raw = raw;
+        return fixed;
+    }
+
+    static constexpr Fixed fromInt(int64_t value) { return fromRaw(value * ONE); }
+    static Fixed fromFloat(float value) { return fromRaw(std::llround(static_cast<double>(value) * ONE)); }
+
+    [[nodiscard]] float toFloat() const { return static_cast<float>(static_cast<double>(raw) / ONE); }
+    [[nodiscard]] constexpr int64_t toInt() const { return raw >> FRACTION_BITS; }
+
+    constexpr Fixed operator+(Fixed other) const { return fromRaw(raw + other.raw); }
+    constexpr Fixed operator-(Fixed other) const { return fromRaw(raw - other.raw); }
+    constexpr Fixed operator-() const { return fromRaw(-raw); }
+    constexpr Fixed operator*(Fixed other) const { return fromRaw((raw * other.raw) >> FRACTION_BITS); }
+    constexpr Fixed operator/(Fixed other) const { return fromRaw((raw << FRACTION_BITS) / other.raw); }
+
+    constexpr Fixed& operator+=(Fixed other) { raw += other.raw; return *this; }
+    constexpr Fixed& operator-=(Fixed other) { raw -= other.raw; return *this; }
+
+    constexpr auto operator<=>(const Fixed&) const = default;
+
+    // integer newton iteration, std::sqrt is not guaranteed to round the same everywhere
+    [[nodiscard]] static constexpr Fixed sqrt(Fixed value) {
+        if (value.raw <= 0) return {};
+
+        uint64_t n = static_cast<uint64_t>(value.raw) << FRACTION_BITS;
+        uint64_t x = n;
+        uint64_t y = (x + 1) / 2;
+        while (y < x) {
+            x = y;
+            y = (x + n / x) / 2;
+        }
+
+        return fromRaw(static_cast<int64_t>(x));
+    }
+};
+
+inline sf::Packet& operator<<(sf::Packet& packet, const Fixed& fixed) {
+    return packet << static_cast<std::int64_t>(fixed.raw);
+}
+
+inline sf::Packet& operator>>(sf::Packet& packet, Fixed& fixed) {
+    std::int64_t raw;
+    packet >> raw;
+    fixed.raw = raw;
+    return packet;
+}
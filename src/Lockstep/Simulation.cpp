@@ -0,0 +1,262 @@
+#include "Simulation.h"
+#include "logy.h"
+#include "Server/Farm.h"
+#include "Server/Soldier.h"
+#include "Server/Structure.h"
+
+#include <algorithm>
+
+namespace {
+// pixels, two soldier widths so the 3x3 cells around a soldier hold everything it can touch
+constexpr int CELL_SIZE = 64;
+
+constexpr int WALL_PRICE = 10;
+constexpr int FARM_PRICE = 100;
+constexpr int SOLDIER_PRICE = 100;
+constexpr int HARVEST_GOLD = 100;
+
+constexpr Fixed SOLDIER_STEP = Fixed::fromRaw(static_cast<int64_t>(SOLDIER_SPEED) * Fixed::ONE / Lockstep::TICK_RATE);
+
+uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+uint64_t cellKey(int64_t cellX, int64_t cellY) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cellY)) << 32) | static_cast<uint32_t>(cellX);
+}
+}
+
+namespace Lockstep {
+void Simulation::init(entt::registry& registry, MapInfo& mapInfo, const NetworkEntityMap& NEP,
+                      const std::vector<EntityUpdate>& world, const std::vector<ID_t>& players, int startingGold) {
+    m_Registry = &registry;
+    m_MapInfo = &mapInfo;
+    m_Tick = 0;
+    m_NextId = 0;
+
+    m_Gold.clear();
+    for (ID_t player: players) m_Gold[player] = startingGold;
+
+    for (const auto& update: world) {
+        if (update.flags & UPDATE_DELETED) continue;
+
+        entt::entity entity = NEP.get(update.id);
+        if (entity == entt::null) {
+            LOG_WARNING("Lockstep world references unknown entity", update.id.id);
+            continue;
+        }
+
+        registry.emplace<LockstepId>(entity, m_NextId++);
+
+        if (update.flags & UPDATE_SOLDIER_CREATED) {
+            registry.emplace<FixedPosition>(
+                    entity, Fixed::fromFloat(update.position.x), Fixed::fromFloat(update.position.y)
+            );
+        }
+    }
+
+    LOG_INFO("Lockstep simulation started with", m_NextId, "entities");
+}
+
+void Simulation::step(const std::vector<Command>& commands) {
+    for (const auto& command: commands) {
+        apply(command);
+    }
+
+    growFarms();
+    separateSoldiers();
+
+    m_Tick++;
+}
+
+int Simulation::gold(ID_t player) const {
+    auto it = m_Gold.find(player);
+    return it == m_Gold.end() ? 0 : it->second;
+}
+
+void Simulation::apply(const Command& command) {
+    auto& registry = *m_Registry;
+
+    auto goldIt = m_Gold.find(command.player);
+    if (goldIt == m_Gold.end()) return;
+    int& gold = goldIt->second;
+
+    int x = static_cast<int>(command.x.toInt());
+    int y = static_cast<int>(command.y.toInt());
+
+    switch (command.type) {
+        case COMMAND_PLACE_WALL:
+        case COMMAND_PLANT_FARM: {
+            int price = command.type == COMMAND_PLACE_WALL ? WALL_PRICE : FARM_PRICE;
+            if (!m_MapInfo->inBounds(x, y) || m_MapInfo->structureAt(x, y) != entt::null) return;
+            if (gold < price) return;
+
+            gold -= price;
+            entt::entity entity = createStructure(command.type == COMMAND_PLACE_WALL ? WALL : FARM, x, y,
+                                                  command.player);
+            if (command.type == COMMAND_PLANT_FARM) registry.emplace<Farm>(entity);
+            break;
+        }
+        case COMMAND_SPAWN_SOLDIER: {
+            Fixed mapPixels = Fixed::fromInt(static_cast<int64_t>(m_MapInfo->size) * 32);
+            if (command.x < Fixed() || command.x >= mapPixels || command.y < Fixed() || command.y >= mapPixels)
+                return;
+            if (gold < SOLDIER_PRICE) return;
+
+            gold -= SOLDIER_PRICE;
+            entt::entity entity = registry.create();
+            registry.emplace<LockstepId>(entity, m_NextId++);
+            registry.emplace<FixedPosition>(entity, command.x, command.y);
+            registry.emplace<Soldier>(entity, Soldier(command.player, SoldierType::Basic, 32.f));
+            break;
+        }
+        case COMMAND_HARVEST: {
+            entt::entity entity = m_MapInfo->structureAt(x, y);
+            if (entity == entt::null) return;
+
+            auto *farm = registry.try_get<Farm>(entity);
+            if (!farm || farm->state != HARVEST) return;
+            if (registry.get<Structure>(entity).owner != command.player) return;
+
+            registry.patch<Farm>(entity, [](Farm& f) { f.state = GROWING; });
+            gold += HARVEST_GOLD;
+            break;
+        }
+    }
+}
+
+entt::entity Simulation::createStructure(StructureType type, int x, int y, ID_t owner) {
+    auto& registry = *m_Registry;
+
+    // the owner's on_construct<Structure> hook fills in the MapInfo, same as for replicated structures
+    entt::entity entity = registry.create();
+    registry.emplace<LockstepId>(entity, m_NextId++);
+    registry.emplace<Structure>(entity, Structure{ .type = type, .x = x, .y = y, .size = 1, .owner = owner });
+    return entity;
+}
+
+void Simulation::growFarms() {
+    auto& registry = *m_Registry;
+
+    for (auto [entity, id, farm]: registry.view<LockstepId, Farm>().each()) {
+        if (farm.state == HARVEST) continue;
+
+        if (++farm.time >= farm.growTime) {
+            registry.patch<Farm>(entity, [](Farm& f) {
+                f.time = 0;
+                f.state = HARVEST;
+            });
+        }
+    }
+}
+
+void Simulation::separateSoldiers() {
+    auto& registry = *m_Registry;
+
+    m_SoldierCells.clear();
+    for (auto [entity, id, position, soldier]: registry.view<LockstepId, FixedPosition, Soldier>().each()) {
+        m_SoldierCells.push_back({
+                cellKey(position.x.toInt() / CELL_SIZE, position.y.toInt() / CELL_SIZE), id.id, entity
+        });
+    }
+
+    // sorted by cell and then id so every machine visits the pairs in the same order
+    std::sort(m_SoldierCells.begin(), m_SoldierCells.end());
+    m_Pushes.assign(m_SoldierCells.size(), FixedPosition{});
+
+    for (std::size_t i = 0; i < m_SoldierCells.size(); i++) {
+        const auto& self = m_SoldierCells[i];
+        const auto& position = registry.get<FixedPosition>(self.entity);
+        Fixed radius = Fixed::fromFloat(registry.get<Soldier>(self.entity).size / 2.f);
+
+        int64_t cellX = position.x.toInt() / CELL_SIZE;
+        int64_t cellY = position.y.toInt() / CELL_SIZE;
+
+        FixedPosition push{};
+        for (int64_t dy = -1; dy <= 1; dy++) {
+            for (int64_t dx = -1; dx <= 1; dx++) {
+                uint64_t key = cellKey(cellX + dx, cellY + dy);
+                auto it = std::lower_bound(m_SoldierCells.begin(), m_SoldierCells.end(),
+                                           SoldierCell{ key, 0, entt::null });
+
+                for (; it != m_SoldierCells.end() && it->cell == key; ++it) {
+                    if (it->id == self.id) continue;
+
+                    const auto& other = registry.get<FixedPosition>(it->entity);
+                    Fixed minDistance = radius + Fixed::fromFloat(registry.get<Soldier>(it->entity).size / 2.f);
+
+                    Fixed offsetX = position.x - other.x;
+                    Fixed offsetY = position.y - other.y;
+                    Fixed distanceSquared = offsetX * offsetX + offsetY * offsetY;
+                    if (distanceSquared >= minDistance * minDistance) continue;
+
+                    // each side moves away by half the overlap
+                    Fixed distance = Fixed::sqrt(distanceSquared);
+                    if (distance == Fixed()) {
+                        push.x += self.id < it->id ? -minDistance / Fixed::fromInt(2) : minDistance / Fixed::fromInt(2);
+                        continue;
+                    }
+
+                    Fixed scale = (minDistance - distance) / Fixed::fromInt(2) / distance;
+                    push.x += offsetX * scale;
+                    push.y += offsetY * scale;
+                }
+            }
+        }
+
+        Fixed length = Fixed::sqrt(push.x * push.x + push.y * push.y);
+        if (length > SOLDIER_STEP) {
+            Fixed scale = SOLDIER_STEP / length;
+            push.x = push.x * scale;
+            push.y = push.y * scale;
+        }
+
+        m_Pushes[i] = push;
+    }
+
+    for (std::size_t i = 0; i < m_SoldierCells.size(); i++) {
+        auto& position = registry.get<FixedPosition>(m_SoldierCells[i].entity);
+        position.x += m_Pushes[i].x;
+        position.y += m_Pushes[i].y;
+    }
+}
+
+uint64_t Simulation::hash() const {
+    const auto& registry = *m_Registry;
+
+    uint64_t hash = mix(m_Tick);
+    for (const auto& [player, gold]: m_Gold) {
+        hash = mix(hash ^ mix(player) ^ static_cast<uint64_t>(gold));
+    }
+
+    // summed so registry iteration order doesn't matter
+    uint64_t entities = 0;
+    for (auto [entity, id]: registry.view<LockstepId>().each()) {
+        uint64_t entityHash = mix(id.id);
+
+        if (const auto *structure = registry.try_get<Structure>(entity)) {
+            entityHash = mix(entityHash ^ static_cast<uint64_t>(structure->type));
+            entityHash = mix(entityHash ^ static_cast<uint32_t>(structure->x));
+            entityHash = mix(entityHash ^ static_cast<uint32_t>(structure->y));
+            entityHash = mix(entityHash ^ structure->owner);
+        }
+
+        if (const auto *farm = registry.try_get<Farm>(entity)) {
+            entityHash = mix(entityHash ^ static_cast<uint64_t>(farm->state));
+            entityHash = mix(entityHash ^ static_cast<uint32_t>(farm->time));
+        }
+
+        if (const auto *position = registry.try_get<FixedPosition>(entity)) {
+            entityHash = mix(entityHash ^ static_cast<uint64_t>(position->x.raw));
+            entityHash = mix(entityHash ^ static_cast<uint64_t>(position->y.raw));
+        }
+
+        entities += entityHash;
+    }
+
+    return mix(hash ^ entities);
+}
+}
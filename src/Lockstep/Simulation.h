@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "entt/entt.hpp"
+#include "Fixed.h"
+#include "Command.h"
+#include "EntityUpdate.h"
+#include "NetworkEntityMap.h"
+#include "Server/MapInfo.h"
+
+namespace Lockstep {
+// ticks per second of the simulation, same as the server tick
+constexpr int TICK_RATE = 20;
+// clients report their state hash every this many ticks
+constexpr uint32_t HASH_INTERVAL = 20;
+
+// order every machine agrees on, entt::entity values differ between registries
+struct LockstepId {
+    uint32_t id;
+};
+
+struct FixedPosition {
+    Fixed x;
+    Fixed y;
+};
+
+// the game logic of Farm, Structure and Soldier in a form that runs bit-identical on the server and every client,
+// so only commands have to go over the network
+class Simulation {
+public:
+    // takes over the starting world, world is the start packet's update list so every machine numbers the
+    // entities the same way
+    void init(entt::registry& registry, MapInfo& mapInfo, const NetworkEntityMap& NEP,
+              const std::vector<EntityUpdate>& world, const std::vector<ID_t>& players, int startingGold);
+
+    // applies the commands in order and advances one tick
+    void step(const std::vector<Command>& commands);
+
+    // order independent hash of everything the simulation owns
+    [[nodiscard]] uint64_t hash() const;
+
+    [[nodiscard]] bool running() const { return m_Registry != nullptr; }
+    [[nodiscard]] uint32_t tick() const { return m_Tick; }
+    [[nodiscard]] int gold(ID_t player) const;
+
+private:
+    void apply(const Command& command);
+    void growFarms();
+    void separateSoldiers();
+
+    entt::entity createStructure(StructureType type, int x, int y, ID_t owner);
+
+    entt::registry *m_Registry = nullptr;
+    MapInfo *m_MapInfo = nullptr;
+
+    uint32_t m_Tick = 0;
+    uint32_t m_NextId = 0;
+    // ordered so the hash walks it the same way everywhere
+    std::map<ID_t, int> m_Gold;
+
+    struct SoldierCell {
+        uint64_t cell;
+        uint32_t id;
+        entt::entity entity;
+
+        auto operator<=>(const SoldierCell& other) const {
+            if (cell != other.cell) return cell <=> other.cell;
+            return id <=> other.id;
+        }
+    };
+
+    std::vector<SoldierCell> m_SoldierCells;
+    std::vector<FixedPosition> m_Pushes;
+};
+}
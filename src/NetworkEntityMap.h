@@ -2,10 +2,28 @@
 
 #include "Utils/Utils.h"
 #include "entt/entt.hpp"
-#include <unordered_map>
+#include "SFML/Network/Packet.hpp"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// low bits index a dense slot, high bits count how often that slot was reused
+using NetworkID_t = uint32_t;
+constexpr uint32_t NETWORK_ID_INDEX_BITS = 20;
+constexpr NetworkID_t NETWORK_ID_INDEX_MASK = (NetworkID_t(1) << NETWORK_ID_INDEX_BITS) - 1;
+constexpr NetworkID_t NETWORK_ID_GENERATION_MASK = std::numeric_limits<NetworkID_t>::max() >> NETWORK_ID_INDEX_BITS;
+constexpr NetworkID_t NETWORK_ID_NULL = std::numeric_limits<NetworkID_t>::max();
 
 struct NetworkID {
-    ID_t id;
+    NetworkID_t id = NETWORK_ID_NULL;
+
+    NetworkID() = default;
+    NetworkID(NetworkID_t id) : id(id) {}
+    NetworkID(uint32_t index, uint32_t generation)
+            : id(((generation & NETWORK_ID_GENERATION_MASK) << NETWORK_ID_INDEX_BITS) | (index & NETWORK_ID_INDEX_MASK)) {}
+
+    [[nodiscard]] uint32_t index() const { return id & NETWORK_ID_INDEX_MASK; }
+    [[nodiscard]] uint32_t generation() const { return id >> NETWORK_ID_INDEX_BITS; }
 };
 
 inline sf::Packet& operator<<(sf::Packet& packet, const NetworkID& info) {
@@ -18,8 +36,16 @@ inline sf::Packet& operator>>(sf::Packet& packet, NetworkID& info) {
 
 struct NetworkEntityMap {
 public:
-    entt::entity get(ID_t id) {
-        return map[id];
+    // entt::null if the id was never seen or the entity it referred to is gone
+    [[nodiscard]] entt::entity get(NetworkID id) const {
+        if (id.index() >= m_Slots.size()) return entt::null;
+
+        const Slot& slot = m_Slots[id.index()];
+        return slot.id == id.id ? slot.entity : entt::null;
+    }
+
+    [[nodiscard]] bool contains(NetworkID id) const {
+        return get(id) != entt::null;
     }
 
     void init(entt::registry &registry) {
@@ -27,13 +53,26 @@ public:
         registry.on_destroy<NetworkID>().connect<&NetworkEntityMap::remove>(this);
     }
 private:
-    std::unordered_map<ID_t, entt::entity> map;
+    struct Slot {
+        NetworkID_t id = NETWORK_ID_NULL;
+        entt::entity entity = entt::null;
+    };
+
+    std::vector<Slot> m_Slots;
 
     void add(entt::registry &registry, entt::entity entity) {
-        map[registry.get<NetworkID>(entity).id] = entity;
+        NetworkID id = registry.get<NetworkID>(entity);
+        if (id.index() >= m_Slots.size()) {
+            m_Slots.resize(id.index() + 1);
+        }
+
+        m_Slots[id.index()] = { id.id, entity };
     }
 
     void remove(entt::registry &registry, entt::entity entity) {
-        map.erase(registry.get<NetworkID>(entity).id);
+        NetworkID id = registry.get<NetworkID>(entity);
+        if (id.index() < m_Slots.size() && m_Slots[id.index()].id == id.id) {
+            m_Slots[id.index()] = {};
+        }
     }
 };
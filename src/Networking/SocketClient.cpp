@@ -7,6 +7,7 @@
 #include "SFML/Network/TcpListener.hpp"
 #include "SFML/System/Time.hpp"
 #include "logy.h"
+#include "Utils/Profiler.h"
 
 #include <exception>
 #include <thread>
@@ -37,11 +38,15 @@ void SocketClient::stop() {
 }
 
 void SocketClient::clientThread() {
+    Utils::Profiler::setThreadName("client receive");
+
     sf::SocketSelector selector;
     selector.add(m_Socket);
 
     while (isRunning() && m_Socket.getRemotePort() != 0) {
         if (selector.wait(sf::milliseconds(10))) {
+            PROFILE_SCOPE("SocketClient::receive");
+
             sf::Packet packet;
             if (m_Socket.receive(packet) != sf::Socket::Status::Done) {
                 LOG_WARNING("Failed to receive packet!");
@@ -67,18 +72,25 @@ void SocketClient::setDisconnectionCallback(DisconnectionCallback callback) {
 }
 
 void SocketClient::send(sf::Packet packet) {
+    std::lock_guard guard(m_SendMutex);
     if (m_Socket.send(packet) != sf::Socket::Status::Done) {
         LOG_WARNING("Failed to send packet");
     }
 }
 
-void SocketClient::handleCallbacks() {
+std::size_t SocketClient::handleCallbacks() {
+    PROFILE_SCOPE("SocketClient::handleCallbacks");
+
     if (!m_ClientThreadRunning) {
         m_DisconnectionCallback();
     }
 
+    m_HandledPackets.clear();
     m_ReceivedPacketsMutex.lock();
-    for (sf::Packet& packet: m_ReceivedPackets) {
+    std::swap(m_ReceivedPackets, m_HandledPackets);
+    m_ReceivedPacketsMutex.unlock();
+
+    for (sf::Packet& packet: m_HandledPackets) {
         ID_t packetType;
 
         try {
@@ -106,7 +118,7 @@ void SocketClient::handleCallbacks() {
 
         m_Callbacks.at(packetType)(packet);
     }
-    m_ReceivedPackets.clear();
-    m_ReceivedPacketsMutex.unlock();
+
+    return m_HandledPackets.size();
 }
 }
@@ -30,9 +30,11 @@ public:
     void start();
     void stop();
 
+    // safe to call from any thread
     void send(sf::Packet packet);
 
-    void handleCallbacks();
+    // runs the callbacks of every packet received since the last call, returns how many there were
+    std::size_t handleCallbacks();
 
     void setDisconnectionCallback(DisconnectionCallback callback);
 
@@ -70,6 +72,10 @@ private:
     std::unordered_map<ID_t, ClientReceiveInternalCallback> m_Callbacks;
     std::mutex m_ReceivedPacketsMutex;
     std::vector<sf::Packet> m_ReceivedPackets;
+    // swapped with m_ReceivedPackets, so the receive thread isn't blocked while the callbacks run
+    std::vector<sf::Packet> m_HandledPackets;
+
+    std::mutex m_SendMutex;
 
     DisconnectionCallback m_DisconnectionCallback;
 
@@ -9,6 +9,8 @@
 #include "SFML/System/Sleep.hpp"
 #include "SFML/System/Time.hpp"
 #include "logy.h"
+#include "Utils/Profiler.h"
+#include "Utils/Metrics.h"
 
 #include <algorithm>
 #include <cstddef>
@@ -17,6 +19,34 @@
 #include <thread>
 #include <utility>
 
+namespace {
+struct SocketServerMetrics {
+    Utils::Metrics::Gauge& connectedClients = Utils::Metrics::gauge(
+            "luntik_connected_clients", "Clients currently connected");
+    Utils::Metrics::Gauge& receiveQueue = Utils::Metrics::gauge(
+            "luntik_receive_queue_packets", "Packets waiting for the tick thread when it last handled callbacks");
+    Utils::Metrics::Counter& packetsReceived = Utils::Metrics::counter(
+            "luntik_packets_received_total", "Packets received from clients");
+    Utils::Metrics::Counter& bytesReceived = Utils::Metrics::counter(
+            "luntik_received_bytes_total", "Packet bytes received from clients");
+    Utils::Metrics::Counter& packetsSent = Utils::Metrics::counter(
+            "luntik_packets_sent_total", "Packets sent to clients");
+    Utils::Metrics::Counter& bytesSent = Utils::Metrics::counter(
+            "luntik_sent_bytes_total", "Packet bytes sent to clients");
+    Utils::Metrics::Counter& sendFailed = Utils::Metrics::counter(
+            "luntik_packets_dropped_total", "Packets that were dropped", { { "reason", "send_failed" } });
+    Utils::Metrics::Counter& receiveFailed = Utils::Metrics::counter(
+            "luntik_packets_dropped_total", "Packets that were dropped", { { "reason", "receive_failed" } });
+    Utils::Metrics::Counter& unknownPacket = Utils::Metrics::counter(
+            "luntik_packets_dropped_total", "Packets that were dropped", { { "reason", "unknown_packet" } });
+};
+
+SocketServerMetrics& metrics() {
+    static SocketServerMetrics s_Metrics;
+    return s_Metrics;
+}
+}
+
 namespace Networking {
 SocketServer::SocketServer(sf::IpAddress ip, uint16_t port)
         : m_Port(port), m_Ip(ip) {
@@ -34,6 +64,26 @@ void SocketServer::start() {
     }
 }
 
+void SocketServer::startHeadless() {
+    m_Headless = true;
+    m_ListenThreadRunning = true;
+}
+
+void SocketServer::injectConnected(ID_t id) {
+    std::lock_guard guard(m_ConnectedClientsMutex);
+    m_ConnectedClients.push_back(id);
+}
+
+void SocketServer::injectDisconnected(ID_t id) {
+    std::lock_guard guard(m_DisconnectedClientsMutex);
+    m_DisconnectedClients.push_back(id);
+}
+
+void SocketServer::injectPacket(ID_t id, sf::Packet packet) {
+    std::lock_guard guard(m_ReceivedPacketsMutex);
+    m_InjectedPackets.emplace_back(id, std::move(packet));
+}
+
 void SocketServer::stop() {
     m_ListenThreadRunning = false;
     if (m_ListenThread.joinable()) {
@@ -55,6 +105,8 @@ void SocketServer::stop() {
 }
 
 void SocketServer::listenThread() {
+    Utils::Profiler::setThreadName("server listen");
+
     sf::TcpListener listener;
 
     if (listener.listen(m_Port, m_Ip) != sf::Socket::Status::Done) {
@@ -103,6 +155,8 @@ void SocketServer::listenThread() {
 }
 
 void SocketServer::clientThread(clientInfo *clientInfo) {
+    Utils::Profiler::setThreadName("server client " + std::to_string(clientInfo->id));
+
     sf::SocketSelector selector;
     selector.add(*clientInfo->socket);
 
@@ -113,12 +167,18 @@ void SocketServer::clientThread(clientInfo *clientInfo) {
     while (clientInfo->isRunning && clientInfo->socket->getRemotePort() != 0 &&
            isListenThreadRunning()) {
         if (selector.wait(sf::milliseconds(10))) {
+            PROFILE_SCOPE("SocketServer::receive");
+
             sf::Packet packet;
             if (clientInfo->socket->receive(packet) != sf::Socket::Status::Done) {
+                metrics().receiveFailed.add();
                 LOG_WARNING("Failed to receive packet!");
                 break;
             }
 
+            metrics().packetsReceived.add();
+            metrics().bytesReceived.add(static_cast<double>(packet.getDataSize()));
+
             m_ReceivedPacketsMutex.lock();
             m_ReceivedPackets[clientInfo->id].push_back(packet);
             m_ReceivedPacketsMutex.unlock();
@@ -150,6 +210,8 @@ bool SocketServer::clientOnline(ID_t id) {
 }
 
 void SocketServer::send(ID_t id, sf::Packet packet) {
+    if (m_Headless) return;
+
     std::lock_guard guard(m_ClientsMutex);
     if (m_Clients.find(id) == m_Clients.end()) {
         LOG_WARNING("Client not online:", id);
@@ -157,19 +219,31 @@ void SocketServer::send(ID_t id, sf::Packet packet) {
     }
 
     if (m_Clients.at(id).socket->send(packet) != sf::Socket::Status::Done) {
+        metrics().sendFailed.add();
         LOG_WARNING("Failed to send packet to client", id);
+        return;
     }
+
+    metrics().packetsSent.add();
+    metrics().bytesSent.add(static_cast<double>(packet.getDataSize()));
 }
 
 void SocketServer::sendAll(sf::Packet packet, ID_t exclude) {
+    if (m_Headless) return;
+
     std::lock_guard guard(m_ClientsMutex);
     for (auto& [id, LOG_INFO]: m_Clients) {
         if (id == exclude)
             continue;
 
         if (LOG_INFO.socket->send(packet) != sf::Socket::Status::Done) {
+            metrics().sendFailed.add();
             LOG_WARNING("Failed to send packet to client", id);
+            continue;
         }
+
+        metrics().packetsSent.add();
+        metrics().bytesSent.add(static_cast<double>(packet.getDataSize()));
     }
 }
 
@@ -183,7 +257,13 @@ void SocketServer::setClientDisconnectedCallback(
     m_ClientDisconnectedCallback = std::move(callback);
 }
 
+void SocketServer::setInputObserver(InputObserver observer) {
+    m_InputObserver = std::move(observer);
+}
+
 void SocketServer::handleCallbacks() {
+    PROFILE_SCOPE("SocketServer::handleCallbacks");
+
     if (!isListenThreadRunning()) {
         LOG_INFO("Listen thread not running");
         return;
@@ -201,51 +281,78 @@ void SocketServer::handleCallbacks() {
     });
     m_ClientsMutex.unlock();
 
+    const sf::Packet noPacket;
+
     m_ConnectedClientsMutex.lock();
+    metrics().connectedClients.add(static_cast<double>(m_ConnectedClients.size()));
     for (ID_t id: m_ConnectedClients) {
+        if (m_InputObserver) m_InputObserver(InputEventType::CONNECTED, id, noPacket);
         m_ClientConnectedCallback(id);
     }
     m_ConnectedClients.clear();
     m_ConnectedClientsMutex.unlock();
 
     m_DisconnectedClientsMutex.lock();
+    metrics().connectedClients.add(-static_cast<double>(m_DisconnectedClients.size()));
     for (ID_t id: m_DisconnectedClients) {
+        if (m_InputObserver) m_InputObserver(InputEventType::DISCONNECTED, id, noPacket);
         m_ClientDisconnectedCallback(id);
     }
     m_DisconnectedClients.clear();
     m_DisconnectedClientsMutex.unlock();
 
     m_ReceivedPacketsMutex.lock();
+    std::size_t queued = m_InjectedPackets.size();
+    for (const auto& [senderId, packets]: m_ReceivedPackets) queued += packets.size();
+    metrics().receiveQueue.set(static_cast<double>(queued));
+
     for (auto& [senderId, packets]: m_ReceivedPackets) {
         for (sf::Packet& packet: packets) {
-            ID_t packetType;
+            dispatch(senderId, packet);
+        }
+    }
+    m_ReceivedPackets.clear();
 
-            try {
-                packetType = getPacketType(packet);
-            } catch (const std::exception& e) {
-                LOG_WARNING("Unable to find packet type");
-                continue;
-            }
+    // injected packets keep the exact order they were recorded in
+    for (auto& [senderId, packet]: m_InjectedPackets) {
+        dispatch(senderId, packet);
+    }
+    m_InjectedPackets.clear();
+    m_ReceivedPacketsMutex.unlock();
+}
 
-            if (!isPacketRegistered(packetType)) {
-                LOG_WARNING("Packet not registered", packetType);
-                continue;
-            }
+void SocketServer::dispatch(ID_t senderId, sf::Packet& packet) {
+    ID_t packetType;
 
-            if (m_Callbacks.find(packetType) == m_Callbacks.end()) {
-                LOG_WARNING("Received packet but no callback was assigned",
-                            packetType);
-                continue;
-            }
+    try {
+        packetType = getPacketType(packet);
+    } catch (const std::exception& e) {
+        metrics().unknownPacket.add();
+        LOG_WARNING("Unable to find packet type");
+        return;
+    }
 
-            m_Callbacks.at(packetType)(senderId, packet);
-        }
+    if (!isPacketRegistered(packetType)) {
+        metrics().unknownPacket.add();
+        LOG_WARNING("Packet not registered", packetType);
+        return;
     }
-    m_ReceivedPackets.clear();
-    m_ReceivedPacketsMutex.unlock();
+
+    if (m_Callbacks.find(packetType) == m_Callbacks.end()) {
+        metrics().unknownPacket.add();
+        LOG_WARNING("Received packet but no callback was assigned",
+                    packetType);
+        return;
+    }
+
+    if (m_InputObserver) m_InputObserver(InputEventType::PACKET, senderId, packet);
+
+    m_Callbacks.at(packetType)(senderId, packet);
 }
 
 void SocketServer::kickClient(ID_t id) {
+    if (m_Headless) return;
+
     std::lock_guard guard(m_ClientsMutex);
     if (m_Clients.find(id) == m_Clients.end()) {
         LOG_WARNING("Tried to kick non-existent client:", id);
@@ -254,4 +361,33 @@ void SocketServer::kickClient(ID_t id) {
 
     m_Clients.at(id).socket->disconnect();
 }
+
+bool SocketServer::reassignClient(ID_t from, ID_t to) {
+    if (m_Headless) return true;
+
+    std::lock_guard guard(m_ClientsMutex);
+    if (m_Clients.find(from) == m_Clients.end() || m_Clients.find(to) != m_Clients.end()) {
+        LOG_WARNING("Can't move client", from, "to", to);
+        return false;
+    }
+
+    // the client thread holds a pointer to its info, extracting the node keeps it where it is
+    auto node = m_Clients.extract(from);
+    node.key() = to;
+    node.mapped().id = to;
+    clientInfo& info = m_Clients.insert(std::move(node)).position->second;
+
+    sf::Packet idPacket;
+    idPacket << ID_t_MAX << to;
+    if (info.socket->send(idPacket) != sf::Socket::Status::Done) {
+        metrics().sendFailed.add();
+        LOG_WARNING("Failed to send new id to client", to);
+    }
+
+    return true;
+}
+
+void SocketServer::reserveClientIds(ID_t next) {
+    m_CurrentClientId = std::max(m_CurrentClientId, next);
+}
 }
@@ -21,6 +21,15 @@ using ClientDisconnectedCallback = std::function<void(ID_t)>;
 
 using ServerReceiveInternalCallback = std::function<void(ID_t, sf::Packet)>;
 
+enum class InputEventType : uint8_t {
+    CONNECTED,
+    DISCONNECTED,
+    PACKET,
+};
+
+// sees every event handleCallbacks dispatches, packet is empty for connects and disconnects
+using InputObserver = std::function<void(InputEventType, ID_t, const sf::Packet&)>;
+
 struct clientInfo {
     std::atomic<ID_t> id;
 
@@ -41,13 +50,20 @@ public:
     bool clientOnline(ID_t id);
 
     void start();
+    // no listener, events only come in through the inject functions and everything sent is dropped
+    void startHeadless();
     void stop();
 
+    void injectConnected(ID_t id);
+    void injectDisconnected(ID_t id);
+    void injectPacket(ID_t id, sf::Packet packet);
+
     void send(ID_t id, sf::Packet packet);
     void sendAll(sf::Packet packet, ID_t exclude = ID_t_MAX);
 
     void setClientConnectedCallback(ClientConnectedCallback callback);
     void setClientDisconnectedCallback(ClientDisconnectedCallback callback);
+    void setInputObserver(InputObserver observer);
 
     void handleCallbacks();
 
@@ -75,10 +91,22 @@ public:
 
     void kickClient(ID_t id);
 
+    // moves the connection of client from over to the unused id to and tells the client, for players coming back
+    // to the id they had. packets it sent before may still arrive with the old id. false if either id doesn't fit
+    bool reassignClient(ID_t from, ID_t to);
+    // new connections get ids from next on, so they don't collide with ids restored from a checkpoint. before start()
+    void reserveClientIds(ID_t next);
+
 private:
     void listenThread();
     void clientThread(clientInfo *clientInfo);
 
+    void dispatch(ID_t senderId, sf::Packet& packet);
+
+    bool m_Headless = false;
+    InputObserver m_InputObserver;
+    std::vector<std::pair<ID_t, sf::Packet>> m_InjectedPackets;
+
     std::atomic<bool> m_ListenThreadRunning = false;
     std::atomic<bool> m_ListenThreadFailed = false;
     std::thread m_ListenThread;
@@ -8,6 +8,8 @@
 #include "NetworkEntityMap.h"
 #include "Server/Soldier.h"
 #include "Server/Position.h"
+#include "EntityUpdate.h"
+#include "Lockstep/Command.h"
 
 enum PacketID {
     C2S_NAME_PACKET,
@@ -23,20 +25,22 @@ enum PacketID {
 
     S2C_GOLD_PACKET,
 
-    S2C_STRUCTURE_PACKET,
-    S2C_STRUCTURE_DELETE_PACKET,
+    S2C_ENTITY_UPDATES_PACKET,
+
+    C2S_VIEW_PACKET,
+    S2C_CHUNK_UNLOAD_PACKET,
 
-    S2C_FARM_PACKET,
     C2S_HARVEST_PACKET,
 
     C2S_PLACE_WALL_PACKET,
     C2S_PLANT_FARM_PACKET,
 
-    S2C_SOLDIER_CREATE_PACKET,
-    S2C_SOLDIER_DELETE_PACKET,
-    S2C_SOLDIER_POSITION_PACKET,
+    C2S_SPAWN_SOLDIER_PACKET,
 
-    C2S_SPAWN_SOLDIER_PACKET
+    S2C_LOCKSTEP_START_PACKET,
+    C2S_COMMAND_PACKET,
+    S2C_COMMAND_FRAME_PACKET,
+    C2S_STATE_HASH_PACKET
 };
 
 inline void registerPackets() {
@@ -49,22 +53,27 @@ inline void registerPackets() {
     Networking::registerPacket<C2S_READY_PACKET, bool>();
     Networking::registerPacket<S2C_READY_PACKET, ID_t, bool>();
 
-    Networking::registerPacket<S2C_START_GAME_PACKET>();
+    Networking::registerPacket<S2C_START_GAME_PACKET, uint32_t, std::vector<EntityUpdate>>();
 
     Networking::registerPacket<S2C_GOLD_PACKET, int>();
 
-    Networking::registerPacket<S2C_STRUCTURE_PACKET, NetworkID, Structure>();
-    Networking::registerPacket<S2C_STRUCTURE_DELETE_PACKET, NetworkID>();
+    Networking::registerPacket<S2C_ENTITY_UPDATES_PACKET, std::vector<EntityUpdate>>();
+
+    // chunk rectangle min x, min y, max x, max y (inclusive)
+    Networking::registerPacket<C2S_VIEW_PACKET, int, int, int, int>();
+    Networking::registerPacket<S2C_CHUNK_UNLOAD_PACKET, std::vector<uint32_t>>();
 
-    Networking::registerPacket<S2C_FARM_PACKET, NetworkID, Farm>();
     Networking::registerPacket<C2S_HARVEST_PACKET, NetworkID>();
 
     Networking::registerPacket<C2S_PLACE_WALL_PACKET, int, int>();
     Networking::registerPacket<C2S_PLANT_FARM_PACKET, int, int>();
 
-    Networking::registerPacket<S2C_SOLDIER_CREATE_PACKET, NetworkID, Soldier, Position>();
-    Networking::registerPacket<S2C_SOLDIER_DELETE_PACKET, NetworkID>();
-    Networking::registerPacket<S2C_SOLDIER_POSITION_PACKET, NetworkID, Position>();
-
     Networking::registerPacket<C2S_SPAWN_SOLDIER_PACKET, float, float>();
+
+    // players and their starting gold
+    Networking::registerPacket<S2C_LOCKSTEP_START_PACKET, std::vector<ID_t>, int>();
+    Networking::registerPacket<C2S_COMMAND_PACKET, Command>();
+    // tick and the commands to apply before stepping it
+    Networking::registerPacket<S2C_COMMAND_FRAME_PACKET, uint32_t, std::vector<Command>>();
+    Networking::registerPacket<C2S_STATE_HASH_PACKET, uint32_t, uint64_t>();
 }
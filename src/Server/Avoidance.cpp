@@ -0,0 +1,325 @@
+#include "Avoidance.h"
+#include "SoldierBuffers.h"
+#include "SpatialGrid.h"
+#include "MapInfo.h"
+#include "SoldierKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Avoidance {
+namespace {
+constexpr float EPSILON = 1e-5f;
+constexpr float TILE_SIZE = 32.f;
+// radius of the circle around a tile
+constexpr float TILE_RADIUS = TILE_SIZE * 0.70710678f;
+
+struct Vec {
+    float x = 0.f;
+    float y = 0.f;
+};
+
+Vec operator+(Vec a, Vec b) { return { a.x + b.x, a.y + b.y }; }
+Vec operator-(Vec a, Vec b) { return { a.x - b.x, a.y - b.y }; }
+Vec operator-(Vec a) { return { -a.x, -a.y }; }
+Vec operator*(Vec a, float s) { return { a.x * s, a.y * s }; }
+Vec operator*(float s, Vec a) { return { a.x * s, a.y * s }; }
+float dot(Vec a, Vec b) { return a.x * b.x + a.y * b.y; }
+float det(Vec a, Vec b) { return a.x * b.y - a.y * b.x; }
+float lengthSquared(Vec a) { return dot(a, a); }
+Vec normalized(Vec a) {
+    float length = std::sqrt(lengthSquared(a));
+    return length > EPSILON ? a * (1.f / length) : Vec{};
+}
+
+// half plane of allowed velocities, everything left of direction through point
+struct Line {
+    Vec point;
+    Vec direction;
+};
+
+struct Neighbour {
+    float distanceSquared;
+    std::size_t index;
+};
+
+// scratch space, one set per worker thread
+thread_local std::vector<Line> t_Lines;
+thread_local std::vector<Line> t_ProjectedLines;
+thread_local std::vector<Neighbour> t_Neighbours;
+thread_local std::vector<float> t_NearX;
+thread_local std::vector<float> t_NearY;
+thread_local std::vector<float> t_NearRadius;
+
+// what soldiers get once the deadline passed, no avoidance, only pushed out of the soldiers they overlap with
+Vec separate(const SoldierBuffers& buffers, const SpatialGrid& grid, const AvoidanceSettings& settings,
+             std::size_t i) {
+    t_NearX.clear();
+    t_NearY.clear();
+    t_NearRadius.clear();
+    grid.query(buffers.x[i], buffers.y[i], settings.neighbourDistance, [&](std::size_t j) {
+        t_NearX.push_back(buffers.x[j]);
+        t_NearY.push_back(buffers.y[j]);
+        t_NearRadius.push_back(buffers.radius[j]);
+    });
+
+    Vec force;
+    SoldierKernels::separation(buffers.x[i], buffers.y[i], buffers.radius[i], t_NearX.data(), t_NearY.data(),
+                               t_NearRadius.data(), t_NearX.size(), force.x, force.y);
+
+    // each overlap adds at most 1, full speed once it's that deep
+    if (lengthSquared(force) > 1.f) force = normalized(force);
+    return force * settings.maxSpeed;
+}
+
+bool linearProgram1(const std::vector<Line>& lines, std::size_t lineNo, float radius, Vec optVelocity,
+                    bool directionOpt, Vec& result) {
+    const Line& line = lines[lineNo];
+    float dotProduct = dot(line.point, line.direction);
+    float discriminant = dotProduct * dotProduct + radius * radius - lengthSquared(line.point);
+
+    // max speed circle fully invalidates this line
+    if (discriminant < 0.f) return false;
+
+    float sqrtDiscriminant = std::sqrt(discriminant);
+    float tLeft = -dotProduct - sqrtDiscriminant;
+    float tRight = -dotProduct + sqrtDiscriminant;
+
+    for (std::size_t i = 0; i < lineNo; i++) {
+        float denominator = det(line.direction, lines[i].direction);
+        float numerator = det(lines[i].direction, line.point - lines[i].point);
+
+        if (std::fabs(denominator) <= EPSILON) {
+            // parallel lines
+            if (numerator < 0.f) return false;
+            continue;
+        }
+
+        float t = numerator / denominator;
+        if (denominator >= 0.f) tRight = std::min(tRight, t);
+        else tLeft = std::max(tLeft, t);
+
+        if (tLeft > tRight) return false;
+    }
+
+    if (directionOpt) {
+        result = dot(optVelocity, line.direction) > 0.f
+                 ? line.point + tRight * line.direction
+                 : line.point + tLeft * line.direction;
+    } else {
+        float t = dot(line.direction, optVelocity - line.point);
+        result = line.point + std::clamp(t, tLeft, tRight) * line.direction;
+    }
+
+    return true;
+}
+
+std::size_t linearProgram2(const std::vector<Line>& lines, float radius, Vec optVelocity, bool directionOpt,
+                           Vec& result) {
+    if (directionOpt) {
+        result = optVelocity * radius;
+    } else if (lengthSquared(optVelocity) > radius * radius) {
+        result = normalized(optVelocity) * radius;
+    } else {
+        result = optVelocity;
+    }
+
+    for (std::size_t i = 0; i < lines.size(); i++) {
+        if (det(lines[i].direction, lines[i].point - result) > 0.f) {
+            Vec previous = result;
+            if (!linearProgram1(lines, i, radius, optVelocity, directionOpt, result)) {
+                result = previous;
+                return i;
+            }
+        }
+    }
+
+    return lines.size();
+}
+
+// infeasible, find the velocity that violates the soldier lines the least while keeping the obstacle lines
+void linearProgram3(const std::vector<Line>& lines, std::size_t obstacleLines, std::size_t beginLine, float radius,
+                    Vec& result) {
+    float distance = 0.f;
+
+    for (std::size_t i = beginLine; i < lines.size(); i++) {
+        if (det(lines[i].direction, lines[i].point - result) <= distance) continue;
+
+        t_ProjectedLines.assign(lines.begin(), lines.begin() + static_cast<std::ptrdiff_t>(obstacleLines));
+
+        for (std::size_t j = obstacleLines; j < i; j++) {
+            Line line;
+            float determinant = det(lines[i].direction, lines[j].direction);
+
+            if (std::fabs(determinant) <= EPSILON) {
+                if (dot(lines[i].direction, lines[j].direction) > 0.f) continue;
+                line.point = 0.5f * (lines[i].point + lines[j].point);
+            } else {
+                line.point = lines[i].point +
+                             (det(lines[j].direction, lines[i].point - lines[j].point) / determinant) *
+                             lines[i].direction;
+            }
+
+            line.direction = normalized(lines[j].direction - lines[i].direction);
+            t_ProjectedLines.push_back(line);
+        }
+
+        Vec previous = result;
+        if (linearProgram2(t_ProjectedLines, radius, { -lines[i].direction.y, lines[i].direction.x }, true, result) <
+            t_ProjectedLines.size()) {
+            // only happens because of floating point errors, keep the last result
+            result = previous;
+        }
+
+        distance = det(lines[i].direction, lines[i].point - result);
+    }
+}
+
+// responsibility is the share of the avoidance this soldier takes on, 0.5 against other soldiers, 1 against structures
+Line orcaLine(Vec relativePosition, Vec relativeVelocity, Vec velocity, float combinedRadius, float timeHorizon,
+              float dt, float responsibility) {
+    float distanceSquared = lengthSquared(relativePosition);
+    float combinedRadiusSquared = combinedRadius * combinedRadius;
+
+    Line line;
+    Vec u;
+
+    if (distanceSquared > combinedRadiusSquared) {
+        float inverseTimeHorizon = 1.f / timeHorizon;
+        Vec w = relativeVelocity - inverseTimeHorizon * relativePosition;
+        float wLengthSquared = lengthSquared(w);
+        float dotProduct = dot(w, relativePosition);
+
+        if (dotProduct < 0.f && dotProduct * dotProduct > combinedRadiusSquared * wLengthSquared) {
+            // project on the cut-off circle
+            float wLength = std::sqrt(wLengthSquared);
+            Vec unitW = w * (1.f / wLength);
+
+            line.direction = { unitW.y, -unitW.x };
+            u = (combinedRadius * inverseTimeHorizon - wLength) * unitW;
+        } else {
+            // project on the legs
+            float leg = std::sqrt(distanceSquared - combinedRadiusSquared);
+
+            if (det(relativePosition, w) > 0.f) {
+                line.direction = Vec{ relativePosition.x * leg - relativePosition.y * combinedRadius,
+                                      relativePosition.x * combinedRadius + relativePosition.y * leg } *
+                                 (1.f / distanceSquared);
+            } else {
+                line.direction = -Vec{ relativePosition.x * leg + relativePosition.y * combinedRadius,
+                                       -relativePosition.x * combinedRadius + relativePosition.y * leg } *
+                                 (1.f / distanceSquared);
+            }
+
+            u = dot(relativeVelocity, line.direction) * line.direction - relativeVelocity;
+        }
+    } else {
+        // already overlapping, get out within this tick
+        float inverseTimeStep = 1.f / dt;
+        Vec w = relativeVelocity - inverseTimeStep * relativePosition;
+        float wLength = std::sqrt(lengthSquared(w));
+        Vec unitW = wLength > EPSILON ? w * (1.f / wLength) : Vec{ 0.f, -1.f };
+
+        line.direction = { unitW.y, -unitW.x };
+        u = (combinedRadius * inverseTimeStep - wLength) * unitW;
+    }
+
+    line.point = velocity + responsibility * u;
+    return line;
+}
+}
+
+std::size_t computeVelocities(SoldierBuffers& buffers, const SpatialGrid& grid, const MapInfo& mapInfo,
+                              const AvoidanceSettings& settings, float dt,
+                              std::chrono::steady_clock::time_point deadline,
+                              std::size_t begin, std::size_t end) {
+    std::size_t skipped = 0;
+    float neighbourDistanceSquared = settings.neighbourDistance * settings.neighbourDistance;
+
+    for (std::size_t i = begin; i < end; i++) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            Vec push = separate(buffers, grid, settings, i);
+            buffers.nextVx[i] = push.x;
+            buffers.nextVy[i] = push.y;
+            skipped++;
+            continue;
+        }
+
+        Vec position{ buffers.x[i], buffers.y[i] };
+        Vec velocity{ buffers.vx[i], buffers.vy[i] };
+        Vec preferred{ buffers.prefX[i], buffers.prefY[i] };
+        float radius = buffers.radius[i];
+
+        t_Lines.clear();
+
+        // structures first, linearProgram3 treats the first lines as hard constraints
+        float obstacleRange = settings.obstacleTimeHorizon * settings.maxSpeed + radius + TILE_RADIUS;
+        int minTileX = std::max(0, static_cast<int>(std::floor((position.x - obstacleRange) / TILE_SIZE)));
+        int maxTileX = std::min(static_cast<int>(mapInfo.size) - 1,
+                                static_cast<int>(std::floor((position.x + obstacleRange) / TILE_SIZE)));
+        int minTileY = std::max(0, static_cast<int>(std::floor((position.y - obstacleRange) / TILE_SIZE)));
+        int maxTileY = std::min(static_cast<int>(mapInfo.size) - 1,
+                                static_cast<int>(std::floor((position.y + obstacleRange) / TILE_SIZE)));
+
+        for (int tileY = minTileY; tileY <= maxTileY; tileY++) {
+            for (int tileX = minTileX; tileX <= maxTileX; tileX++) {
+                if (mapInfo.structureAt(tileX, tileY) == entt::null) continue;
+
+                Vec tileCenter{ (tileX + 0.5f) * TILE_SIZE, (tileY + 0.5f) * TILE_SIZE };
+                Vec relativePosition = tileCenter - position;
+                if (lengthSquared(relativePosition) > obstacleRange * obstacleRange) continue;
+
+                t_Lines.push_back(orcaLine(relativePosition, velocity, velocity, radius + TILE_RADIUS,
+                                           settings.obstacleTimeHorizon, dt, 1.f));
+            }
+        }
+
+        std::size_t obstacleLines = t_Lines.size();
+
+        t_Neighbours.clear();
+        grid.query(position.x, position.y, settings.neighbourDistance, [&](std::size_t j) {
+            if (j == i) return;
+
+            float dx = buffers.x[j] - position.x;
+            float dy = buffers.y[j] - position.y;
+            float distanceSquared = dx * dx + dy * dy;
+            if (distanceSquared > neighbourDistanceSquared) return;
+
+            if (t_Neighbours.size() == settings.maxNeighbours) {
+                if (distanceSquared >= t_Neighbours.back().distanceSquared) return;
+                t_Neighbours.pop_back();
+            }
+
+            auto it = std::upper_bound(
+                    t_Neighbours.begin(), t_Neighbours.end(), distanceSquared,
+                    [](float d, const Neighbour& n) { return d < n.distanceSquared; }
+            );
+            t_Neighbours.insert(it, { distanceSquared, j });
+        });
+
+        for (const auto& neighbour: t_Neighbours) {
+            std::size_t j = neighbour.index;
+            Vec relativePosition{ buffers.x[j] - position.x, buffers.y[j] - position.y };
+            Vec relativeVelocity = velocity - Vec{ buffers.vx[j], buffers.vy[j] };
+
+            t_Lines.push_back(orcaLine(relativePosition, relativeVelocity, velocity, radius + buffers.radius[j],
+                                       settings.timeHorizon, dt, 0.5f));
+        }
+
+        Vec result;
+        std::size_t lineFail = linearProgram2(t_Lines, settings.maxSpeed, preferred, false, result);
+        if (lineFail < t_Lines.size()) {
+            linearProgram3(t_Lines, obstacleLines, lineFail, settings.maxSpeed, result);
+        }
+
+        // don't send tiny drifts as movement
+        if (lengthSquared(result) < 1e-2f) result = {};
+
+        buffers.nextVx[i] = result.x;
+        buffers.nextVy[i] = result.y;
+    }
+
+    return skipped;
+}
+}
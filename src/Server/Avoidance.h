@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+struct SoldierBuffers;
+struct MapInfo;
+class SpatialGrid;
+
+struct AvoidanceSettings {
+    // how far ahead (seconds) soldiers avoid each other and structures
+    float timeHorizon = 1.5f;
+    float obstacleTimeHorizon = 0.5f;
+
+    // only this many closest soldiers within neighbourDistance are taken into account
+    std::size_t maxNeighbours = 10;
+    float neighbourDistance = 96.f;
+
+    float maxSpeed = 96.f;
+
+    // per tick, soldiers left over when it runs out are only pushed apart for that tick
+    std::chrono::microseconds budget{ 8000 };
+};
+
+// ORCA (optimal reciprocal collision avoidance), every soldier picks the velocity closest to its preferred one
+// that stays collision free for timeHorizon assuming the others do their half of the work.
+// structure tiles are static obstacles the soldier has to avoid on its own
+namespace Avoidance {
+// fills nextVx/nextVy for soldiers [begin, end) from prefX/prefY (already scaled to pixels per second),
+// returns how many soldiers only got the separation push because the deadline passed
+std::size_t computeVelocities(SoldierBuffers& buffers, const SpatialGrid& grid, const MapInfo& mapInfo,
+                              const AvoidanceSettings& settings, float dt,
+                              std::chrono::steady_clock::time_point deadline,
+                              std::size_t begin, std::size_t end);
+}
@@ -0,0 +1,471 @@
+#include "Checkpoint.h"
+#include "logy.h"
+#include "Structure.h"
+#include "Farm.h"
+#include "Soldier.h"
+#include "Position.h"
+#include "Hitbox.h"
+#include "Velocity.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LTK_CHECKPOINT_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr char CHECKPOINT_MAGIC[4] = { 'L', 'T', 'K', 'C' };
+constexpr uint16_t CHECKPOINT_VERSION = 1;
+
+struct Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t reserved;
+    uint64_t payloadSize;
+    uint64_t checksum;
+};
+
+constexpr uint32_t tag(const char (&name)[5]) {
+    return static_cast<uint32_t>(name[0]) | static_cast<uint32_t>(name[1]) << 8 |
+           static_cast<uint32_t>(name[2]) << 16 | static_cast<uint32_t>(name[3]) << 24;
+}
+
+constexpr uint32_t SECTION_META = tag("META");
+constexpr uint32_t SECTION_PLAYERS = tag("PLYR");
+constexpr uint32_t SECTION_NETWORK_IDS = tag("NIDS");
+constexpr uint32_t SECTION_NETWORK_ID = tag("CNID");
+constexpr uint32_t SECTION_STRUCTURE = tag("CSTR");
+constexpr uint32_t SECTION_FARM = tag("CFRM");
+constexpr uint32_t SECTION_SOLDIER = tag("CSLD");
+constexpr uint32_t SECTION_POSITION = tag("CPOS");
+constexpr uint32_t SECTION_HITBOX = tag("CHBX");
+constexpr uint32_t SECTION_VELOCITY = tag("CVEL");
+
+uint64_t checksum(const char *data, std::size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void appendBytes(std::vector<char>& out, const void *data, std::size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+template<typename T>
+void put(std::vector<char>& out, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    appendBytes(out, &value, sizeof(T));
+}
+
+template<typename T>
+void putVector(std::vector<char>& out, const std::vector<T>& values) {
+    put(out, static_cast<uint32_t>(values.size()));
+    appendBytes(out, values.data(), values.size() * sizeof(T));
+}
+
+// returns where the section size goes, filled in by endSection
+std::size_t beginSection(std::vector<char>& out, uint32_t sectionTag) {
+    put(out, sectionTag);
+    std::size_t sizeOffset = out.size();
+    put(out, uint64_t(0));
+    return sizeOffset;
+}
+
+void endSection(std::vector<char>& out, std::size_t sizeOffset) {
+    uint64_t size = out.size() - sizeOffset - sizeof(uint64_t);
+    std::memcpy(out.data() + sizeOffset, &size, sizeof(size));
+}
+
+template<typename Component>
+void saveComponents(std::vector<char>& out, uint32_t sectionTag, const entt::registry& registry) {
+    static_assert(std::is_trivially_copyable_v<Component>);
+
+    std::size_t section = beginSection(out, sectionTag);
+
+    const auto *storage = registry.storage<Component>();
+    auto count = static_cast<uint32_t>(storage ? storage->size() : 0);
+    put(out, count);
+
+    if (count > 0) {
+        appendBytes(out, storage->data(), count * sizeof(entt::entity));
+
+        std::size_t components = out.size();
+        out.resize(components + count * sizeof(Component));
+        for (uint32_t i = 0; i < count; i++) {
+            std::memcpy(out.data() + components + i * sizeof(Component), &storage->get(storage->data()[i]),
+                        sizeof(Component));
+        }
+    }
+
+    endSection(out, section);
+}
+
+struct Reader {
+    const char *data;
+    std::size_t size;
+    std::size_t position = 0;
+
+    bool bytes(void *destination, std::size_t count) {
+        if (size - position < count) return false;
+        std::memcpy(destination, data + position, count);
+        position += count;
+        return true;
+    }
+
+    template<typename T>
+    bool get(T& value) {
+        return bytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    bool getVector(std::vector<T>& values) {
+        uint32_t count;
+        if (!get(count) || (size - position) / sizeof(T) < count) return false;
+        values.resize(count);
+        return bytes(values.data(), count * sizeof(T));
+    }
+};
+
+template<typename Component>
+bool loadComponents(Reader reader, entt::registry& registry) {
+    uint32_t count;
+    if (!reader.get(count)) return false;
+    if ((reader.size - reader.position) / (sizeof(entt::entity) + sizeof(Component)) < count) return false;
+
+    std::vector<entt::entity> entities(count);
+    std::vector<Component> components(count);
+    reader.bytes(entities.data(), count * sizeof(entt::entity));
+    reader.bytes(components.data(), count * sizeof(Component));
+
+    // entity ids are kept as they were so every section refers to the same entities
+    for (entt::entity entity: entities) {
+        if (registry.valid(entity)) continue;
+
+        if (registry.create(entity) != entity) {
+            LOG_WARNING("Checkpoint entity can't be recreated");
+            return false;
+        }
+    }
+
+    registry.insert<Component>(entities.begin(), entities.end(), components.begin());
+    return true;
+}
+
+// whole file in memory, mapped where possible
+class FileView {
+public:
+    explicit FileView(const std::string& path) {
+#if LTK_CHECKPOINT_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat info{};
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                m_Data = static_cast<const char *>(mapping);
+                m_Size = info.st_size;
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return;
+
+        m_Buffer.resize(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+        if (!file.read(m_Buffer.data(), static_cast<std::streamsize>(m_Buffer.size()))) return;
+
+        m_Data = m_Buffer.data();
+        m_Size = m_Buffer.size();
+#endif
+    }
+
+    ~FileView() {
+#if LTK_CHECKPOINT_MMAP
+        if (m_Data) ::munmap(const_cast<char *>(m_Data), m_Size);
+#endif
+    }
+
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    [[nodiscard]] const char *data() const { return m_Data; }
+    [[nodiscard]] std::size_t size() const { return m_Size; }
+
+private:
+    const char *m_Data = nullptr;
+    std::size_t m_Size = 0;
+#if !LTK_CHECKPOINT_MMAP
+    std::vector<char> m_Buffer;
+#endif
+};
+
+bool writeFile(const std::string& path, const Header& header, const std::vector<char>& payload) {
+    std::size_t total = sizeof(Header) + payload.size();
+
+#if LTK_CHECKPOINT_MMAP
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    if (::ftruncate(fd, static_cast<off_t>(total)) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *mapping = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    std::memcpy(mapping, &header, sizeof(Header));
+    std::memcpy(static_cast<char *>(mapping) + sizeof(Header), payload.data(), payload.size());
+
+    bool synced = ::msync(mapping, total, MS_SYNC) == 0;
+    ::munmap(mapping, total);
+    ::close(fd);
+    return synced;
+#else
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    return static_cast<bool>(file.flush());
+#endif
+}
+}
+
+namespace Checkpoint {
+void save(const ServerGameState& state, uint32_t tick, std::vector<char>& out) {
+    out.clear();
+
+    {
+        std::size_t section = beginSection(out, SECTION_META);
+        put(out, tick);
+        put(out, static_cast<uint8_t>(state.gameStage));
+        put(out, state.mapInfo.size);
+        endSection(out, section);
+    }
+
+    {
+        std::size_t section = beginSection(out, SECTION_PLAYERS);
+        put(out, static_cast<uint32_t>(state.players.size()));
+        for (const auto& [id, info]: state.players) {
+            put(out, static_cast<uint64_t>(id));
+            put(out, static_cast<int32_t>(info.gold));
+            put(out, static_cast<uint8_t>(info.ready));
+            put(out, static_cast<uint32_t>(info.name.size()));
+            appendBytes(out, info.name.data(), info.name.size());
+        }
+        endSection(out, section);
+    }
+
+    {
+        std::size_t section = beginSection(out, SECTION_NETWORK_IDS);
+        putVector(out, state.networkIds.generations());
+        putVector(out, state.networkIds.freeIndices());
+        endSection(out, section);
+    }
+
+    saveComponents<NetworkID>(out, SECTION_NETWORK_ID, state.registry);
+    saveComponents<Structure>(out, SECTION_STRUCTURE, state.registry);
+    saveComponents<Farm>(out, SECTION_FARM, state.registry);
+    saveComponents<Soldier>(out, SECTION_SOLDIER, state.registry);
+    saveComponents<Position>(out, SECTION_POSITION, state.registry);
+    saveComponents<Hitbox>(out, SECTION_HITBOX, state.registry);
+    saveComponents<Velocity>(out, SECTION_VELOCITY, state.registry);
+}
+
+bool load(const std::string& path, ServerGameState& state, uint32_t& tick) {
+    FileView file(path);
+    if (!file.data() || file.size() < sizeof(Header)) {
+        LOG_WARNING("Failed to read checkpoint", path);
+        return false;
+    }
+
+    Header header{};
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.headerSize != sizeof(Header) || header.payloadSize != file.size() - sizeof(Header)) {
+        LOG_WARNING("Not a checkpoint:", path);
+        return false;
+    }
+
+    if (header.version != CHECKPOINT_VERSION) {
+        LOG_WARNING("Unsupported checkpoint version", header.version);
+        return false;
+    }
+
+    const char *payload = file.data() + sizeof(Header);
+    if (checksum(payload, header.payloadSize) != header.checksum) {
+        LOG_WARNING("Checkpoint is corrupted:", path);
+        return false;
+    }
+
+    // sections can come in any order, the components have to go in in a fixed one
+    std::unordered_map<uint32_t, Reader> sections;
+    Reader reader{ payload, header.payloadSize };
+    while (reader.position < reader.size) {
+        uint32_t sectionTag;
+        uint64_t sectionSize;
+        if (!reader.get(sectionTag) || !reader.get(sectionSize) || reader.size - reader.position < sectionSize) {
+            LOG_WARNING("Checkpoint section is cut off");
+            return false;
+        }
+
+        sections[sectionTag] = Reader{ reader.data + reader.position, sectionSize };
+        reader.position += sectionSize;
+    }
+
+    for (uint32_t required: { SECTION_META, SECTION_PLAYERS, SECTION_NETWORK_IDS }) {
+        if (!sections.contains(required)) {
+            LOG_WARNING("Checkpoint is missing a section");
+            return false;
+        }
+    }
+
+    {
+        Reader& meta = sections[SECTION_META];
+        uint8_t stage;
+        if (!meta.get(tick) || !meta.get(stage) || !meta.get(state.mapInfo.size)) return false;
+
+        state.gameStage = static_cast<GameStage>(stage);
+        state.mapInfo.init();
+    }
+
+    {
+        Reader& players = sections[SECTION_PLAYERS];
+        uint32_t count;
+        if (!players.get(count)) return false;
+
+        state.players.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            uint64_t id;
+            int32_t gold;
+            uint8_t ready;
+            uint32_t nameSize;
+            if (!players.get(id) || !players.get(gold) || !players.get(ready) || !players.get(nameSize) ||
+                players.size - players.position < nameSize)
+                return false;
+
+            std::string name(players.data + players.position, nameSize);
+            players.position += nameSize;
+
+            state.players[id] = ServerPlayerInfo{
+                    .name = std::move(name), .id = static_cast<ID_t>(id), .ready = ready != 0, .gold = gold
+            };
+        }
+    }
+
+    {
+        Reader& networkIds = sections[SECTION_NETWORK_IDS];
+        std::vector<uint32_t> generations;
+        std::vector<uint32_t> freeIndices;
+        if (!networkIds.getVector(generations) || !networkIds.getVector(freeIndices)) return false;
+
+        state.networkIds.restore(std::move(generations), std::move(freeIndices));
+    }
+
+    // NetworkID first, the Structure and Soldier signals look it up
+    auto restore = [&sections, &state]<typename Component>(uint32_t sectionTag) {
+        auto it = sections.find(sectionTag);
+        return it == sections.end() || loadComponents<Component>(it->second, state.registry);
+    };
+
+    bool loaded = restore.operator()<NetworkID>(SECTION_NETWORK_ID) &&
+                  restore.operator()<Structure>(SECTION_STRUCTURE) &&
+                  restore.operator()<Farm>(SECTION_FARM) &&
+                  restore.operator()<Position>(SECTION_POSITION) &&
+                  restore.operator()<Hitbox>(SECTION_HITBOX) &&
+                  restore.operator()<Velocity>(SECTION_VELOCITY) &&
+                  restore.operator()<Soldier>(SECTION_SOLDIER);
+
+    if (!loaded) {
+        LOG_WARNING("Checkpoint components are cut off");
+        return false;
+    }
+
+    // soldiers without a Velocity get one, the tick writes it in place
+    for (auto entity: state.registry.view<Soldier>(entt::exclude<Velocity>)) {
+        state.registry.emplace<Velocity>(entity);
+    }
+
+    return true;
+}
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    if (!m_Thread.joinable()) return;
+
+    {
+        std::lock_guard guard(m_Mutex);
+        m_Stop = true;
+    }
+    m_Condition.notify_one();
+    m_Thread.join();
+}
+
+void CheckpointWriter::start(const std::string& path) {
+    if (m_Thread.joinable()) return;
+
+    m_Path = path;
+    m_Thread = std::thread(&CheckpointWriter::run, this);
+}
+
+bool CheckpointWriter::busy() const {
+    std::lock_guard guard(m_Mutex);
+    return m_HasPending;
+}
+
+bool CheckpointWriter::submit(std::vector<char>& snapshot) {
+    {
+        std::lock_guard guard(m_Mutex);
+        if (m_HasPending) return false;
+
+        std::swap(m_Pending, snapshot);
+        m_HasPending = true;
+    }
+
+    m_Condition.notify_one();
+    return true;
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock lock(m_Mutex);
+
+    while (true) {
+        m_Condition.wait(lock, [this] { return m_HasPending || m_Stop; });
+        if (!m_HasPending) return;
+
+        // m_Pending belongs to this thread until m_HasPending is cleared
+        lock.unlock();
+
+        Header header{};
+        std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+        header.version = CHECKPOINT_VERSION;
+        header.headerSize = sizeof(Header);
+        header.payloadSize = m_Pending.size();
+        header.checksum = checksum(m_Pending.data(), m_Pending.size());
+
+        std::string temporaryPath = m_Path + ".tmp";
+        if (!writeFile(temporaryPath, header, m_Pending) || std::rename(temporaryPath.c_str(), m_Path.c_str()) != 0) {
+            LOG_WARNING("Failed to write checkpoint", m_Path);
+        }
+
+        lock.lock();
+        m_HasPending = false;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ServerGameState.h"
+
+// flat binary snapshot of a ServerGameState, a header followed by tagged sections so newer versions can add
+// sections old readers skip. components are copied as raw memory, so a checkpoint only loads into the same build
+// architecture it was written on
+namespace Checkpoint {
+// serializes everything into out, cheap enough to run on the tick thread
+void save(const ServerGameState& state, uint32_t tick, std::vector<char>& out);
+
+// loads into a freshly constructed state whose registry signals are already connected
+bool load(const std::string& path, ServerGameState& state, uint32_t& tick);
+}
+
+// writes snapshots to disk on its own thread, through a temporary file that is renamed over the old checkpoint
+class CheckpointWriter {
+public:
+    CheckpointWriter() = default;
+    ~CheckpointWriter();
+
+    void start(const std::string& path);
+    [[nodiscard]] bool enabled() const { return m_Thread.joinable(); }
+
+    // the previous snapshot is still being written, a new one would only be thrown away by submit
+    [[nodiscard]] bool busy() const;
+
+    // swaps the snapshot with the writer's spare buffer, false if the previous snapshot is still being written
+    bool submit(std::vector<char>& snapshot);
+
+private:
+    void run();
+
+    std::string m_Path;
+    std::thread m_Thread;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::vector<char> m_Pending;
+    bool m_HasPending = false;
+    bool m_Stop = false;
+};
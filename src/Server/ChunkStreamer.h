@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Utils/Utils.h"
+#include "MapInfo.h"
+
+// inclusive rectangle of chunk coordinates
+struct ChunkRect {
+    int minX = 0;
+    int minY = 0;
+    int maxX = -1;
+    int maxY = -1;
+
+    [[nodiscard]] bool empty() const { return maxX < minX || maxY < minY; }
+
+    [[nodiscard]] bool contains(int x, int y) const {
+        return x >= minX && x <= maxX && y >= minY && y <= maxY;
+    }
+
+    bool operator==(const ChunkRect&) const = default;
+};
+
+// keeps track of which chunks every player is subscribed to, structures are only replicated to players that can see
+// their chunk while soldiers and other chunkless entities go to everyone
+class ChunkStreamer {
+public:
+    // largest view side in chunks a client may subscribe to
+    static constexpr int MAX_VIEW_CHUNKS = 8;
+
+    void init(uint32_t chunksPerSide) {
+        m_ChunksPerSide = static_cast<int>(chunksPerSide);
+        m_Views.clear();
+    }
+
+    void addPlayer(ID_t player) { m_Views.emplace(player, ChunkRect{}); }
+    void removePlayer(ID_t player) { m_Views.erase(player); }
+    [[nodiscard]] bool hasPlayer(ID_t player) const { return m_Views.contains(player); }
+
+    [[nodiscard]] const std::unordered_map<ID_t, ChunkRect>& views() const { return m_Views; }
+
+    // clamps the view to the map and fills the chunks that became visible and the ones that stopped being visible.
+    // a view with nothing left after clamping is ignored
+    void setView(ID_t player, ChunkRect view, std::vector<uint32_t>& entered, std::vector<uint32_t>& left) {
+        entered.clear();
+        left.clear();
+
+        auto it = m_Views.find(player);
+        if (it == m_Views.end() || m_ChunksPerSide <= 0) return;
+
+        // the view comes straight from the client, min is clamped first so adding to it can't overflow
+        int last = m_ChunksPerSide - 1;
+        view.minX = std::clamp(view.minX, 0, last);
+        view.minY = std::clamp(view.minY, 0, last);
+        view.maxX = std::min({ view.maxX, last, view.minX + MAX_VIEW_CHUNKS - 1 });
+        view.maxY = std::min({ view.maxY, last, view.minY + MAX_VIEW_CHUNKS - 1 });
+        if (view.empty()) return;
+
+        ChunkRect old = it->second;
+        if (old == view) return;
+
+        for (int y = view.minY; y <= view.maxY; y++)
+            for (int x = view.minX; x <= view.maxX; x++)
+                if (!old.contains(x, y)) entered.push_back(index(x, y));
+
+        for (int y = old.minY; y <= old.maxY; y++)
+            for (int x = old.minX; x <= old.maxX; x++)
+                if (!view.contains(x, y)) left.push_back(index(x, y));
+
+        it->second = view;
+    }
+
+    [[nodiscard]] bool isVisible(ID_t player, uint32_t chunk) const {
+        if (chunk == MAP_CHUNK_NONE) return true;
+
+        auto it = m_Views.find(player);
+        if (it == m_Views.end()) return false;
+
+        return it->second.contains(static_cast<int>(chunk % m_ChunksPerSide), static_cast<int>(chunk / m_ChunksPerSide));
+    }
+
+private:
+    [[nodiscard]] uint32_t index(int x, int y) const { return static_cast<uint32_t>(y * m_ChunksPerSide + x); }
+
+    int m_ChunksPerSide = 0;
+    std::unordered_map<ID_t, ChunkRect> m_Views;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "entt/entt.hpp"
+#include "NetworkEntityMap.h"
+#include "MapInfo.h"
+
+// networked entities that changed during the current tick, in the order they were first touched
+class DirtySet {
+public:
+    struct Entry {
+        entt::entity entity;
+        NetworkID id;
+        uint8_t flags;
+        // chunk the entity lives in, MAP_CHUNK_NONE for entities every client sees
+        uint32_t chunk;
+    };
+
+    void mark(entt::entity entity, NetworkID id, uint8_t flags, uint32_t chunk = MAP_CHUNK_NONE) {
+        auto [it, inserted] = m_Index.try_emplace(id.id, m_Entries.size());
+        if (inserted) {
+            m_Entries.push_back({ entity, id, 0, MAP_CHUNK_NONE });
+        }
+
+        m_Entries[it->second].flags |= flags;
+        if (chunk != MAP_CHUNK_NONE) m_Entries[it->second].chunk = chunk;
+    }
+
+    [[nodiscard]] uint8_t flagsOf(NetworkID id) const {
+        auto it = m_Index.find(id.id);
+        return it == m_Index.end() ? 0 : m_Entries[it->second].flags;
+    }
+
+    [[nodiscard]] const std::vector<Entry>& entries() const { return m_Entries; }
+    [[nodiscard]] bool empty() const { return m_Entries.empty(); }
+
+    void clear() {
+        m_Entries.clear();
+        m_Index.clear();
+    }
+
+private:
+    std::vector<Entry> m_Entries;
+    std::unordered_map<NetworkID_t, std::size_t> m_Index;
+};
@@ -0,0 +1,125 @@
+#include "InputJournal.h"
+#include "logy.h"
+
+#include <cstring>
+
+// records are written in host byte order, replaying on a machine with different endianness isn't supported
+namespace {
+constexpr char JOURNAL_MAGIC[4] = { 'L', 'T', 'K', 'J' };
+constexpr uint16_t JOURNAL_VERSION = 1;
+constexpr uint8_t JOURNAL_FLAG_LOCKSTEP = 1;
+
+// flush about once a second so a crash loses little
+constexpr uint32_t FLUSH_INTERVAL = 20;
+constexpr std::size_t WRITE_BUFFER_SIZE = 1 << 16;
+}
+
+bool InputJournalWriter::open(const std::string& path, bool lockstep) {
+    m_Buffer.resize(WRITE_BUFFER_SIZE);
+    m_File.rdbuf()->pubsetbuf(m_Buffer.data(), static_cast<std::streamsize>(m_Buffer.size()));
+
+    m_File.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_File.is_open()) {
+        LOG_WARNING("Failed to open input journal", path);
+        return false;
+    }
+
+    m_File.write(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    write(JOURNAL_VERSION);
+    write(static_cast<uint8_t>(lockstep ? JOURNAL_FLAG_LOCKSTEP : 0));
+
+    LOG_INFO("Writing input journal to", path);
+    return true;
+}
+
+void InputJournalWriter::header(JournalRecordType type, uint32_t tick) {
+    write(static_cast<uint8_t>(type));
+    write(tick);
+}
+
+void InputJournalWriter::tick(uint32_t tick, float deltaTime) {
+    if (!isOpen()) return;
+
+    header(JOURNAL_TICK, tick);
+    write(deltaTime);
+
+    if (tick % FLUSH_INTERVAL == 0) m_File.flush();
+}
+
+void InputJournalWriter::connected(uint32_t tick, ID_t client) {
+    if (!isOpen()) return;
+
+    header(JOURNAL_CONNECTED, tick);
+    write(static_cast<uint64_t>(client));
+}
+
+void InputJournalWriter::disconnected(uint32_t tick, ID_t client) {
+    if (!isOpen()) return;
+
+    header(JOURNAL_DISCONNECTED, tick);
+    write(static_cast<uint64_t>(client));
+}
+
+void InputJournalWriter::packet(uint32_t tick, ID_t client, const sf::Packet& packet) {
+    if (!isOpen()) return;
+
+    header(JOURNAL_PACKET, tick);
+    write(static_cast<uint64_t>(client));
+    write(static_cast<uint32_t>(packet.getDataSize()));
+    m_File.write(static_cast<const char *>(packet.getData()), static_cast<std::streamsize>(packet.getDataSize()));
+}
+
+bool InputJournalReader::open(const std::string& path) {
+    m_File.open(path, std::ios::binary);
+    if (!m_File.is_open()) {
+        LOG_WARNING("Failed to open input journal", path);
+        return false;
+    }
+
+    char magic[sizeof(JOURNAL_MAGIC)];
+    uint16_t version;
+    uint8_t flags;
+    if (!m_File.read(magic, sizeof(magic)) || std::memcmp(magic, JOURNAL_MAGIC, sizeof(magic)) != 0 ||
+        !read(version) || !read(flags)) {
+        LOG_WARNING("Not an input journal:", path);
+        return false;
+    }
+
+    if (version != JOURNAL_VERSION) {
+        LOG_WARNING("Unsupported input journal version", version);
+        return false;
+    }
+
+    m_Lockstep = flags & JOURNAL_FLAG_LOCKSTEP;
+
+    return true;
+}
+
+bool InputJournalReader::next(JournalRecord& record) {
+    uint8_t type;
+    if (!read(type) || !read(record.tick)) return false;
+    record.type = static_cast<JournalRecordType>(type);
+
+    switch (record.type) {
+        case JOURNAL_TICK:
+            return read(record.deltaTime);
+        case JOURNAL_CONNECTED:
+        case JOURNAL_DISCONNECTED: {
+            uint64_t client;
+            if (!read(client)) return false;
+            record.client = static_cast<ID_t>(client);
+            return true;
+        }
+        case JOURNAL_PACKET: {
+            uint64_t client;
+            uint32_t size;
+            if (!read(client) || !read(size)) return false;
+            record.client = static_cast<ID_t>(client);
+            record.data.resize(size);
+            return static_cast<bool>(m_File.read(record.data.data(), size));
+        }
+    }
+
+    LOG_WARNING("Unknown input journal record", static_cast<int>(type));
+    return false;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "SFML/Network/Packet.hpp"
+#include "Utils/Utils.h"
+
+// every record starts with its type and the server tick it happened in, a tick record closes the tick and holds
+// the delta time it was simulated with
+enum JournalRecordType : uint8_t {
+    JOURNAL_TICK,
+    JOURNAL_CONNECTED,
+    JOURNAL_DISCONNECTED,
+    JOURNAL_PACKET,
+};
+
+struct JournalRecord {
+    JournalRecordType type = JOURNAL_TICK;
+    uint32_t tick = 0;
+    ID_t client = 0;
+    float deltaTime = 0.f;
+    // raw packet bytes, including the packet id
+    std::vector<char> data;
+};
+
+// append-only binary log of what clients sent, written on the tick thread
+class InputJournalWriter {
+public:
+    // the journal remembers the server mode so replays run the same one
+    bool open(const std::string& path, bool lockstep);
+    [[nodiscard]] bool isOpen() const { return m_File.is_open(); }
+
+    void tick(uint32_t tick, float deltaTime);
+    void connected(uint32_t tick, ID_t client);
+    void disconnected(uint32_t tick, ID_t client);
+    void packet(uint32_t tick, ID_t client, const sf::Packet& packet);
+
+private:
+    void header(JournalRecordType type, uint32_t tick);
+
+    template<typename T>
+    void write(const T& value) {
+        m_File.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    // declared before the stream so it outlives the final flush
+    std::vector<char> m_Buffer;
+    std::ofstream m_File;
+};
+
+class InputJournalReader {
+public:
+    bool open(const std::string& path);
+    [[nodiscard]] bool lockstep() const { return m_Lockstep; }
+
+    // false at the end of the journal or when the rest of it is cut off
+    bool next(JournalRecord& record);
+
+private:
+    template<typename T>
+    bool read(T& value) {
+        return static_cast<bool>(m_File.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+    std::ifstream m_File;
+    bool m_Lockstep = false;
+};
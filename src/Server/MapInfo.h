@@ -1,21 +1,91 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <memory>
 #include "Structure.h"
 #include <vector>
 #include <entt/entt.hpp>
 
+// side of a chunk in tiles
+constexpr int MAP_CHUNK_SIZE = 32;
+constexpr uint32_t MAP_CHUNK_NONE = UINT32_MAX;
+
+struct MapChunk {
+    std::array<entt::entity, MAP_CHUNK_SIZE * MAP_CHUNK_SIZE> structures;
+    // number of non-null tiles, the chunk is freed when it drops to zero
+    uint32_t occupied = 0;
+
+    MapChunk() {
+        structures.fill(entt::null);
+    }
+};
+
+// the map is split into MAP_CHUNK_SIZE^2 tile chunks which are only allocated once something is placed in them,
+// so a 1024x1024 map costs one pointer per chunk until it gets built on
 struct MapInfo {
-    uint16_t size = 32;
-    std::vector<std::vector<entt::entity>> structures;
+    uint32_t size = 32;
 
     MapInfo() = default;
 
     void init() {
-        structures.resize(size, std::vector<entt::entity>(size));
+        m_ChunksPerSide = (size + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+        m_Chunks.clear();
+        m_Chunks.resize(static_cast<size_t>(m_ChunksPerSide) * m_ChunksPerSide);
+    }
 
-        for (int i = 0; i < size; i++)
-            for (int j = 0; j < size; j++)
-                structures[i][j] = entt::null;
+    [[nodiscard]] bool inBounds(int x, int y) const {
+        return x >= 0 && y >= 0 && x < static_cast<int>(size) && y < static_cast<int>(size);
     }
+
+    [[nodiscard]] uint32_t chunksPerSide() const { return m_ChunksPerSide; }
+
+    // chunk index of the chunk holding tile x, y
+    [[nodiscard]] uint32_t chunkIndex(int x, int y) const {
+        if (!inBounds(x, y)) return MAP_CHUNK_NONE;
+        return (y / MAP_CHUNK_SIZE) * m_ChunksPerSide + x / MAP_CHUNK_SIZE;
+    }
+
+    [[nodiscard]] entt::entity structureAt(int x, int y) const {
+        if (!inBounds(x, y)) return entt::null;
+
+        const auto& chunk = m_Chunks[chunkIndex(x, y)];
+        if (!chunk) return entt::null;
+
+        return chunk->structures[(y % MAP_CHUNK_SIZE) * MAP_CHUNK_SIZE + x % MAP_CHUNK_SIZE];
+    }
+
+    void setStructure(int x, int y, entt::entity entity) {
+        if (!inBounds(x, y)) return;
+
+        auto& chunk = m_Chunks[chunkIndex(x, y)];
+        if (!chunk) {
+            if (entity == entt::null) return;
+            chunk = std::make_unique<MapChunk>();
+        }
+
+        entt::entity& tile = chunk->structures[(y % MAP_CHUNK_SIZE) * MAP_CHUNK_SIZE + x % MAP_CHUNK_SIZE];
+        if (tile == entt::null && entity != entt::null) chunk->occupied++;
+        if (tile != entt::null && entity == entt::null) chunk->occupied--;
+        tile = entity;
+
+        if (chunk->occupied == 0) chunk.reset();
+    }
+
+    // nullptr when nothing was ever placed in the chunk
+    [[nodiscard]] const MapChunk *chunk(uint32_t index) const {
+        if (index >= m_Chunks.size()) return nullptr;
+        return m_Chunks[index].get();
+    }
+
+    [[nodiscard]] size_t allocatedChunks() const {
+        size_t count = 0;
+        for (const auto& chunk: m_Chunks)
+            if (chunk) count++;
+        return count;
+    }
+
+private:
+    uint32_t m_ChunksPerSide = 0;
+    std::vector<std::unique_ptr<MapChunk>> m_Chunks;
 };
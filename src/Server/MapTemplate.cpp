@@ -0,0 +1,176 @@
+#include "MapTemplate.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "logy.h"
+#include "NetworkIdAllocator.h"
+#include "Farm.h"
+#include "Position.h"
+#include "Velocity.h"
+#include "Hitbox.h"
+
+namespace {
+bool parseStructureType(const std::string& name, StructureType& type) {
+    if (name == "castle") type = CASTLE;
+    else if (name == "farm") type = FARM;
+    else if (name == "wall") type = WALL;
+    else return false;
+    return true;
+}
+
+bool parseSoldierType(const std::string& name, SoldierType& type) {
+    if (name == "basic") type = SoldierType::Basic;
+    else return false;
+    return true;
+}
+}
+
+bool MapTemplate::loadFromFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        LOG_WARNING("Failed to open map template", path);
+        return false;
+    }
+
+    structures.clear();
+    soldiers.clear();
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        std::istringstream stream(line);
+        std::string keyword;
+        if (!(stream >> keyword) || keyword[0] == '#') continue;
+
+        bool valid;
+        if (keyword == "size") {
+            valid = static_cast<bool>(stream >> mapSize);
+        } else if (keyword == "base") {
+            valid = static_cast<bool>(stream >> baseSpacing >> basesPerRow) && baseSpacing > 0 && basesPerRow > 0;
+        } else if (keyword == "gold") {
+            valid = static_cast<bool>(stream >> startingGold);
+        } else if (keyword == "structure") {
+            std::string type;
+            StructureEntry entry{};
+            valid = stream >> type >> entry.x >> entry.y >> entry.size && parseStructureType(type, entry.type);
+            if (valid) structures.push_back(entry);
+        } else if (keyword == "soldier") {
+            std::string type;
+            SoldierEntry entry{};
+            valid = stream >> type >> entry.x >> entry.y >> entry.size && parseSoldierType(type, entry.type);
+            if (valid) soldiers.push_back(entry);
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            LOG_WARNING("Invalid line in map template", path, "line", lineNumber);
+            structures.clear();
+            soldiers.clear();
+            return false;
+        }
+    }
+
+    // every base is baseSpacing tiles wide, anything reaching out of it would overlap the next base or the edge
+    for (const auto& entry: structures) {
+        if (entry.size < 1 || entry.x < 0 || entry.y < 0 ||
+            entry.x + entry.size > baseSpacing || entry.y + entry.size > baseSpacing) {
+            LOG_WARNING("Map template", path, "has a structure at", entry.x, entry.y, "outside of its base");
+            structures.clear();
+            soldiers.clear();
+            return false;
+        }
+    }
+    for (const auto& entry: soldiers) {
+        if (entry.x < 0 || entry.y < 0 || entry.x >= static_cast<float>(baseSpacing) ||
+            entry.y >= static_cast<float>(baseSpacing)) {
+            LOG_WARNING("Map template", path, "has a soldier at", entry.x, entry.y, "outside of its base");
+            structures.clear();
+            soldiers.clear();
+            return false;
+        }
+    }
+
+    LOG_INFO("Loaded map template", path, "with", structures.size(), "structures and", soldiers.size(), "soldiers");
+    return true;
+}
+
+uint32_t MapTemplate::mapSizeFor(std::size_t owners) const {
+    if (owners == 0) return mapSize;
+
+    auto columns = std::min(owners, static_cast<std::size_t>(basesPerRow));
+    auto rows = (owners + basesPerRow - 1) / basesPerRow;
+    auto needed = static_cast<uint32_t>(std::max(columns, rows) * baseSpacing);
+    return std::max(mapSize, needed);
+}
+
+void MapTemplate::instantiate(entt::registry& registry, NetworkIdAllocator& networkIds,
+                              const std::vector<ID_t>& owners) const {
+    if (networkIds.available() < (structures.size() + soldiers.size()) * owners.size()) {
+        LOG_WARNING("Not enough network ids left for the map template, starting without it");
+        return;
+    }
+
+    auto baseX = [this](std::size_t base) { return static_cast<int>(base % basesPerRow) * baseSpacing; };
+    auto baseY = [this](std::size_t base) { return static_cast<int>(base / basesPerRow) * baseSpacing; };
+
+    // NetworkID has to go in first, the Structure/Soldier signals use it for replication
+    {
+        std::vector<entt::entity> entities(structures.size() * owners.size());
+        std::vector<NetworkID> ids(entities.size());
+        std::vector<Structure> components(entities.size());
+        std::vector<entt::entity> farms;
+
+        registry.create(entities.begin(), entities.end());
+
+        std::size_t i = 0;
+        for (std::size_t base = 0; base < owners.size(); base++) {
+            for (const auto& entry: structures) {
+                ids[i] = networkIds.allocate();
+                components[i] = Structure{
+                        .type = entry.type,
+                        .x = baseX(base) + entry.x,
+                        .y = baseY(base) + entry.y,
+                        .size = entry.size,
+                        .owner = owners[base]
+                };
+                if (entry.type == FARM) farms.push_back(entities[i]);
+                i++;
+            }
+        }
+
+        registry.insert<NetworkID>(entities.begin(), entities.end(), ids.begin());
+        registry.insert<Structure>(entities.begin(), entities.end(), components.begin());
+        registry.insert<Farm>(farms.begin(), farms.end());
+    }
+
+    {
+        std::vector<entt::entity> entities(soldiers.size() * owners.size());
+        std::vector<NetworkID> ids(entities.size());
+        std::vector<Position> positions(entities.size());
+        std::vector<Soldier> components(entities.size());
+        std::vector<Hitbox> hitboxes(entities.size());
+
+        registry.create(entities.begin(), entities.end());
+
+        std::size_t i = 0;
+        for (std::size_t base = 0; base < owners.size(); base++) {
+            for (const auto& entry: soldiers) {
+                ids[i] = networkIds.allocate();
+                positions[i] = Position{ 32.f * (baseX(base) + entry.x), 32.f * (baseY(base) + entry.y) };
+                components[i] = Soldier(owners[base], entry.type, entry.size);
+                hitboxes[i] = Hitbox(entry.size, entry.size / 2.f);
+                i++;
+            }
+        }
+
+        registry.insert<NetworkID>(entities.begin(), entities.end(), ids.begin());
+        registry.insert<Position>(entities.begin(), entities.end(), positions.begin());
+        registry.insert<Hitbox>(entities.begin(), entities.end(), hitboxes.begin());
+        registry.insert<Velocity>(entities.begin(), entities.end());
+        registry.insert<Soldier>(entities.begin(), entities.end(), components.begin());
+    }
+}
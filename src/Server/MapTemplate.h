@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "entt/entt.hpp"
+#include "Utils/Utils.h"
+#include "Structure.h"
+#include "Soldier.h"
+
+class NetworkIdAllocator;
+
+// starting layout every player gets when the game starts, loaded from assets/maps/*.map
+struct MapTemplate {
+    struct StructureEntry {
+        StructureType type;
+        int x;
+        int y;
+        int size;
+    };
+
+    struct SoldierEntry {
+        SoldierType type;
+        float x;
+        float y;
+        float size;
+    };
+
+    uint32_t mapSize = 32;
+    int baseSpacing = 10;
+    int basesPerRow = 2;
+    int startingGold = 0;
+
+    std::vector<StructureEntry> structures;
+    std::vector<SoldierEntry> soldiers;
+
+    // false if the file can't be read or a structure or soldier sticks out of its base
+    bool loadFromFile(const std::string& path);
+
+    // tiles per side the map needs so every owner's base fits, at least mapSize. the map stays square, bases
+    // are added row by row
+    [[nodiscard]] uint32_t mapSizeFor(std::size_t owners) const;
+
+    // creates the layout for every owner at once, base i goes to owners[i]. the map has to be at least
+    // mapSizeFor(owners.size()) tiles per side. places nothing if there aren't enough network ids left for all of it
+    void instantiate(entt::registry& registry, NetworkIdAllocator& networkIds, const std::vector<ID_t>& owners) const;
+};
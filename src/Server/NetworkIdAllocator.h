@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "NetworkEntityMap.h"
+
+// hands out NetworkIDs, slots of destroyed entities go back on a free list and come back with the next generation
+class NetworkIdAllocator {
+public:
+    void init(entt::registry& registry) {
+        registry.on_destroy<NetworkID>().connect<&NetworkIdAllocator::onDestroy>(this);
+    }
+
+    // NETWORK_ID_NULL once every index is in use, the caller rejects whatever wanted the id
+    NetworkID allocate() {
+        if (!m_FreeIndices.empty()) {
+            uint32_t index = m_FreeIndices.back();
+            m_FreeIndices.pop_back();
+            return { index, m_Generations[index] };
+        }
+
+        // the last index is never handed out, at the last generation it would encode to NETWORK_ID_NULL
+        if (m_Generations.size() >= NETWORK_ID_INDEX_MASK) return {};
+
+        m_Generations.push_back(0);
+        return { static_cast<uint32_t>(m_Generations.size() - 1), 0 };
+    }
+
+    void release(NetworkID id) {
+        uint32_t index = id.index();
+        if (index >= m_Generations.size() || m_Generations[index] != id.generation()) return;
+
+        m_Generations[index] = (m_Generations[index] + 1) & NETWORK_ID_GENERATION_MASK;
+        m_FreeIndices.push_back(index);
+    }
+
+    [[nodiscard]] std::size_t liveCount() const { return m_Generations.size() - m_FreeIndices.size(); }
+    // how many more ids allocate can hand out
+    [[nodiscard]] std::size_t available() const { return NETWORK_ID_INDEX_MASK - liveCount(); }
+
+    // for checkpoints
+    [[nodiscard]] const std::vector<uint32_t>& generations() const { return m_Generations; }
+    [[nodiscard]] const std::vector<uint32_t>& freeIndices() const { return m_FreeIndices; }
+
+    void restore(std::vector<uint32_t> generations, std::vector<uint32_t> freeIndices) {
+        m_Generations = std::move(generations);
+        m_FreeIndices = std::move(freeIndices);
+    }
+
+private:
+    void onDestroy(entt::registry& registry, entt::entity entity) {
+        release(registry.get<NetworkID>(entity));
+    }
+
+    std::vector<uint32_t> m_Generations;
+    std::vector<uint32_t> m_FreeIndices;
+};
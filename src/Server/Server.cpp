@@ -1,16 +1,66 @@
 #include "Server.h"
 #include "Utils/Timers.h"
+#include "Utils/Profiler.h"
 #include "Packets.h"
 #include "NetworkEntityMap.h"
 #include "Farm.h"
 #include "Networking/Overloads.h"
 #include "Soldier.h"
+#include "Velocity.h"
 #include "Hitbox.h"
+#include "SoldierKernels.h"
+#include "Avoidance.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <filesystem>
+
+namespace {
+struct ServerMetrics {
+    Utils::Metrics::Counter& ticks = Utils::Metrics::counter(
+            "luntik_ticks_total", "Server ticks run");
+    Utils::Metrics::Histogram& tickDuration = Utils::Metrics::histogram(
+            "luntik_tick_duration_seconds", "Time spent in one server tick",
+            { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1 });
+
+    Utils::Metrics::Counter& callbacks = system("callbacks");
+    Utils::Metrics::Counter& farms = system("farms");
+    Utils::Metrics::Counter& soldierGather = system("soldier_gather");
+    Utils::Metrics::Counter& avoidance = system("avoidance");
+    Utils::Metrics::Counter& integrate = system("integrate");
+    Utils::Metrics::Counter& commit = system("commit");
+    Utils::Metrics::Counter& replication = system("replication");
+    Utils::Metrics::Counter& lockstep = system("lockstep");
+    Utils::Metrics::Counter& checkpoint = system("checkpoint");
+
+    Utils::Metrics::Gauge& structures = entities("structure");
+    Utils::Metrics::Gauge& farmEntities = entities("farm");
+    Utils::Metrics::Gauge& soldiers = entities("soldier");
+    Utils::Metrics::Gauge& networked = entities("network_id");
+
+    static Utils::Metrics::Counter& system(const char *name) {
+        return Utils::Metrics::counter("luntik_system_seconds_total", "Time spent in each tick system",
+                                       { { "system", name } });
+    }
+
+    static Utils::Metrics::Gauge& entities(const char *component) {
+        return Utils::Metrics::gauge("luntik_entities", "Entities with each component",
+                                     { { "component", component } });
+    }
+};
+
+ServerMetrics& metrics() {
+    static ServerMetrics s_Metrics;
+    return s_Metrics;
+}
+}
 
-Server::Server(sf::IpAddress ip, uint16_t port) : m_Ip(ip), m_Port(port), m_SocketServer(ip, port) {
+Server::Server(sf::IpAddress ip, uint16_t port, bool lockstep)
+        : m_Ip(ip), m_Port(port), m_SocketServer(ip, port), m_Lockstep(lockstep) {
     m_IsRunning = false;
+
+    m_GrownFarms.resize(m_Jobs.workerCount());
 }
 
 Server::~Server() {
@@ -24,7 +74,203 @@ void Server::start() {
         return;
     }
 
+    setup();
+
+    if (!m_CheckpointPath.empty()) {
+        restoreCheckpoint();
+        m_Checkpoints.start(m_CheckpointPath);
+    }
+
+    m_SocketServer.start();
+    if (!m_SocketServer.isListenThreadRunning()) {
+        LOG_WARNING("Failed to start socket server thread");
+        return;
+    }
+
+    m_IsRunning = true;
+    LOG_INFO("Server started");
+}
+
+void Server::enableCheckpoints(const std::string& path, uint32_t interval) {
+    if (m_Lockstep) {
+        LOG_WARNING("Checkpoints aren't supported in lockstep mode");
+        return;
+    }
+
+    m_CheckpointPath = path;
+    m_CheckpointInterval = std::max(interval, 1u);
+}
+
+void Server::restoreCheckpoint() {
+    if (!std::filesystem::exists(m_CheckpointPath)) return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    uint32_t tick;
+    if (!Checkpoint::load(m_CheckpointPath, m_GameState, tick)) {
+        LOG_WARNING("Starting without the checkpoint");
+        // the registry keeps its signal connections, so it gets emptied instead of replaced
+        m_GameState.registry.clear();
+        m_GameState.players.clear();
+        m_GameState.networkIds.restore({}, {});
+        m_GameState.mapInfo = MapInfo{};
+        m_GameState.gameStage = LOBBY;
+        m_DirtySet.clear();
+        return;
+    }
+
+    m_Tick = tick + 1;
+    // nobody is connected to receive the restored world, the players get it when they rejoin
+    m_DirtySet.clear();
+    m_ChunkStreamer.init(m_GameState.mapInfo.chunksPerSide());
+
+    m_RejoinNames.clear();
+    ID_t nextClientId = 0;
+    for (const auto& [id, info]: m_GameState.players) {
+        if (m_GameState.gameStage == GAME && info.isReady()) m_RejoinNames.emplace(info.name, id);
+        nextClientId = std::max(nextClientId, id + 1);
+    }
+    // new connections must not take the id of a restored player before it rejoins
+    m_SocketServer.reserveClientIds(nextClientId);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Restored checkpoint from tick", tick, "with", m_GameState.registry.storage<NetworkID>().size(),
+             "entities in", ms, "ms");
+}
+
+void Server::rejoin(ID_t client, const std::string& name) {
+    auto it = m_RejoinNames.find(name);
+    if (it == m_RejoinNames.end()) {
+        LOG_WARNING("Client", client, "tried to join the running game as", name, "but no such player left it");
+        m_SocketServer.kickClient(client);
+        return;
+    }
+
+    ID_t player = it->second;
+    if (!m_SocketServer.reassignClient(client, player)) {
+        m_SocketServer.kickClient(client);
+        return;
+    }
+    m_RejoinNames.erase(it);
+
+    m_SocketServer.send(player, Networking::createPacket<S2C_LOBBY_PACKET>(m_GameState.players));
+
+    // soldiers go to everyone, structures follow once the client reports its view
+    m_ChunkStreamer.addPlayer(player);
+    m_PlayerUpdates.clear();
+    appendSoldiers(m_PlayerUpdates);
+    m_SocketServer.send(player, Networking::createPacket<S2C_START_GAME_PACKET>(
+            m_GameState.mapInfo.size, m_PlayerUpdates
+    ));
+    m_SocketServer.send(player, Networking::createPacket<S2C_GOLD_PACKET>(m_GameState.players[player].gold));
+
+    LOG_INFO("Client", client, "rejoined as", name, "with id", player);
+}
+
+bool Server::serveMetrics(uint16_t port) {
+    metrics();
+    return m_MetricsServer.serve(port);
+}
+
+void Server::writeMetrics(const std::string& path) {
+    metrics();
+    m_MetricsFile.writeFile(path, 5.0);
+}
+
+void Server::updateMetrics() {
+    ServerMetrics& m = metrics();
+
+    // the profile is in milliseconds
+    m.ticks.add();
+    m.tickDuration.observe(m_TickProfile.total() / 1000.0);
+
+    m.callbacks.add(m_TickProfile.callbacks / 1000.0);
+    m.farms.add(m_TickProfile.farms / 1000.0);
+    m.soldierGather.add(m_TickProfile.soldierGather / 1000.0);
+    m.avoidance.add(m_TickProfile.avoidance / 1000.0);
+    m.integrate.add(m_TickProfile.integrate / 1000.0);
+    m.commit.add(m_TickProfile.commit / 1000.0);
+    m.replication.add(m_TickProfile.replication / 1000.0);
+    m.lockstep.add(m_TickProfile.lockstep / 1000.0);
+    m.checkpoint.add(m_TickProfile.checkpoint / 1000.0);
+
+    // a const registry hands out storage pointers that may be null, these are always there
+    entt::registry& registry = m_GameState.registry;
+    m.structures.set(static_cast<double>(registry.storage<Structure>().size()));
+    m.farmEntities.set(static_cast<double>(registry.storage<Farm>().size()));
+    m.soldiers.set(static_cast<double>(registry.storage<Soldier>().size()));
+    m.networked.set(static_cast<double>(registry.storage<NetworkID>().size()));
+}
+
+bool Server::openJournal(const std::string& path) {
+    return m_Journal.open(path, m_Lockstep);
+}
+
+bool Server::replay(const std::string& path) {
+    InputJournalReader reader;
+    if (!reader.open(path)) return false;
+
+    LOG_INFO("Replaying", path);
+
+    m_Lockstep = reader.lockstep();
+    setup();
+    m_SocketServer.startHeadless();
+    m_IsRunning = true;
+
+    std::vector<double> tickTimes;
+    JournalRecord record;
+    auto replayStart = std::chrono::steady_clock::now();
+
+    while (reader.next(record)) {
+        switch (record.type) {
+            case JOURNAL_CONNECTED:
+                m_SocketServer.injectConnected(record.client);
+                break;
+            case JOURNAL_DISCONNECTED:
+                m_SocketServer.injectDisconnected(record.client);
+                break;
+            case JOURNAL_PACKET: {
+                sf::Packet packet;
+                packet.append(record.data.data(), record.data.size());
+                m_SocketServer.injectPacket(record.client, std::move(packet));
+                break;
+            }
+            case JOURNAL_TICK: {
+                auto tickStart = std::chrono::steady_clock::now();
+                tick(record.deltaTime);
+                tickTimes.push_back(
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tickStart).count()
+                );
+                break;
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replayStart).count();
+    m_IsRunning = false;
+
+    if (tickTimes.empty()) {
+        LOG_WARNING("Journal has no ticks");
+        return false;
+    }
+
+    std::sort(tickTimes.begin(), tickTimes.end());
+    auto percentile = [&tickTimes](double p) {
+        return tickTimes[std::min(tickTimes.size() - 1, static_cast<std::size_t>(p * tickTimes.size()))];
+    };
+
+    LOG_INFO("Replayed", tickTimes.size(), "ticks in", seconds, "s,", tickTimes.size() / seconds, "ticks/s");
+    LOG_INFO("Tick ms p50:", percentile(0.5), "p99:", percentile(0.99), "max:", tickTimes.back());
+    return true;
+}
+
+void Server::setup() {
+    if (!m_MapTemplate.loadFromFile("assets/maps/default.map")) {
+        LOG_WARNING("Players will start with an empty map");
+    }
+
     m_GameState.NEP.init(m_GameState.registry);
+    m_GameState.networkIds.init(m_GameState.registry);
     m_GameState.registry.on_construct<Structure>().connect<&Server::onCreateStructure>(this);
     m_GameState.registry.on_destroy<Structure>().connect<&Server::onDeleteStructure>(this);
 
@@ -34,10 +280,27 @@ void Server::start() {
     m_GameState.registry.on_construct<Soldier>().connect<&Server::onCreateSoldier>(this);
     m_GameState.registry.on_destroy<Soldier>().connect<&Server::onDeleteSoldier>(this);
 
+    m_SocketServer.setInputObserver([this](Networking::InputEventType type, ID_t client, const sf::Packet& packet) {
+        switch (type) {
+            case Networking::InputEventType::CONNECTED:
+                m_Journal.connected(m_Tick, client);
+                break;
+            case Networking::InputEventType::DISCONNECTED:
+                m_Journal.disconnected(m_Tick, client);
+                break;
+            case Networking::InputEventType::PACKET:
+                m_Journal.packet(m_Tick, client, packet);
+                break;
+        }
+    });
+
     m_SocketServer.setClientConnectedCallback([this](ID_t id) {
         if (m_GameState.gameStage != LOBBY) {
-            LOG_WARNING("Client", id, "tried to connect but game stage is not lobby");
-            m_SocketServer.kickClient(id);
+            // it can only take the place of a player that left, which one is decided by the name it sends
+            if (m_RejoinNames.empty()) {
+                LOG_WARNING("Client", id, "tried to connect but game stage is not lobby");
+                m_SocketServer.kickClient(id);
+            }
             return;
         }
 
@@ -58,8 +321,14 @@ void Server::start() {
         if (m_GameState.gameStage == LOBBY) {
             m_GameState.players.erase(id);
             m_SocketServer.sendAll(Networking::createPacket<S2C_PLAYER_QUIT_PACKET>(id));
+        } else if (!m_Lockstep) {
+            // lockstep clients simulate from the start of the game, so only streamed games can be rejoined
+            auto it = m_GameState.players.find(id);
+            if (it != m_GameState.players.end() && it->second.isReady()) m_RejoinNames.emplace(it->second.name, id);
         }
 
+        m_ChunkStreamer.removePlayer(id);
+
         LOG_INFO("Client disconnected:", id);
     });
 
@@ -97,210 +366,52 @@ void Server::start() {
                         }
                     }
 
-                    m_SocketServer.sendAll(Networking::createPacket<S2C_START_GAME_PACKET>());
+                    std::vector<ID_t> owners;
+                    for (const auto& [sendId, info]: m_GameState.players) {
+                        if (info.isReady()) owners.push_back(sendId);
+                    }
 
-                    m_GameState.mapInfo.size = 32;
+                    // more players than the template's map has room for get a bigger map
+                    m_GameState.mapInfo.size = m_MapTemplate.mapSizeFor(owners.size());
+                    if (m_GameState.mapInfo.size != m_MapTemplate.mapSize) {
+                        LOG_INFO("Grew the map to", m_GameState.mapInfo.size, "tiles for", owners.size(), "players");
+                    }
                     m_GameState.mapInfo.init();
 
-                    {
-                        int i = 0;
-                        for (auto& [sendId, info]: m_GameState.players) {
-                            info.gold = 100000;
-                            m_SocketServer.send(sendId, Networking::createPacket<S2C_GOLD_PACKET>(info.gold));
-
-                            auto castle = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(castle, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    castle,
-                                    Structure{
-                                            .type = StructureType::CASTLE,
-                                            .x = 2 + (i % 2) * 10,
-                                            .y = 2 + (int) std::floor(i / 2) * 10,
-                                            .size = 2,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto farm = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(farm, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    farm,
-                                    Structure{
-                                            .type = StructureType::FARM,
-                                            .x = 2 + (i % 2) * 10,
-                                            .y = 5 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-                            m_GameState.registry.emplace<Farm>(farm);
-
-                            auto farm2 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(farm2, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    farm2,
-                                    Structure{
-                                            .type = StructureType::FARM,
-                                            .x = 3 + (i % 2) * 10,
-                                            .y = 5 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-                            m_GameState.registry.emplace<Farm>(farm2);
-
-                            // walls
-                            auto wall = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 2 + (i % 2) * 10,
-                                            .y = 6 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto wall2 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall2, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall2,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 3 + (i % 2) * 10,
-                                            .y = 6 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto wall7 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall7, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall7,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 2 + (i % 2) * 10,
-                                            .y = 4 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto wall8 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall8, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall8,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 3 + (i % 2) * 10,
-                                            .y = 4 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto wall3 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall3, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall3,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 4 + (i % 2) * 10,
-                                            .y = 6 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto wall4 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall4, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall4,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 4 + (i % 2) * 10,
-                                            .y = 5 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto wall5 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall5, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall5,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 4 + (i % 2) * 10,
-                                            .y = 4 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto wall6 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall6, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall6,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 1 + (i % 2) * 10,
-                                            .y = 4 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto wall9 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall9, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall9,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 1 + (i % 2) * 10,
-                                            .y = 5 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            auto wall10 = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(wall10, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Structure>(
-                                    wall10,
-                                    Structure{
-                                            .type = StructureType::WALL,
-                                            .x = 1 + (i % 2) * 10,
-                                            .y = 6 + (int) std::floor(i / 2) * 10,
-                                            .size = 1,
-                                            .owner = sendId
-                                    }
-                            );
-
-                            // add a soldier
-                            float soldierSize = 32.f;
-                            auto soldier = m_GameState.registry.create();
-                            m_GameState.registry.emplace<NetworkID>(soldier, m_GameState.networkId++);
-                            m_GameState.registry.emplace<Position>(soldier,
-                                                                   32.f * (3 + float(i % 2) * 10.f),
-                                                                   32.f * (8 + (float) std::floor(i / 2) * 10.f)
-                            );
-                            m_GameState.registry.emplace<Soldier>(
-                                    soldier,
-                                    Soldier(
-                                            sendId,
-                                            SoldierType::Basic,
-                                            soldierSize
-                                    )
-                            );
-                            m_GameState.registry.emplace<Hitbox>(soldier, Hitbox(soldierSize, soldierSize / 2.f));
-
-                            i++;
+                    m_ChunkStreamer.init(m_GameState.mapInfo.chunksPerSide());
+                    for (ID_t owner: owners) m_ChunkStreamer.addPlayer(owner);
+
+                    m_MapTemplate.instantiate(m_GameState.registry, m_GameState.networkIds, owners);
+
+                    // the starting world goes out with the start packet instead of the next tick's updates,
+                    // nobody has a view yet so structures follow once the clients report theirs
+                    collectDirty(m_EntityUpdates, m_EntityUpdateChunks);
+
+                    if (m_Lockstep) {
+                        // every client simulates the whole map so it gets all of it
+                        m_SocketServer.sendAll(Networking::createPacket<S2C_START_GAME_PACKET>(
+                                m_GameState.mapInfo.size, m_EntityUpdates
+                        ));
+
+                        m_Simulation.init(m_GameState.registry, m_GameState.mapInfo, m_GameState.NEP,
+                                          m_EntityUpdates, owners, m_MapTemplate.startingGold);
+                        m_SocketServer.sendAll(Networking::createPacket<S2C_LOCKSTEP_START_PACKET>(
+                                owners, m_MapTemplate.startingGold
+                        ));
+                    } else {
+                        for (ID_t owner: owners) {
+                            filterVisible(owner, m_PlayerUpdates);
+                            m_SocketServer.send(owner, Networking::createPacket<S2C_START_GAME_PACKET>(
+                                    m_GameState.mapInfo.size, m_PlayerUpdates
+                            ));
                         }
                     }
+
+                    for (ID_t owner: owners) {
+                        auto& info = m_GameState.players[owner];
+                        info.gold = m_MapTemplate.startingGold;
+                        m_SocketServer.send(owner, Networking::createPacket<S2C_GOLD_PACKET>(info.gold));
+                    }
                 }
             })
     );
@@ -308,6 +419,17 @@ void Server::start() {
     m_SocketServer.addReceiveCallback(
             C2S_NAME_PACKET,
             std::function<void(ID_t, std::string)>([this](ID_t id, std::string name) {
+                if (m_GameState.gameStage != LOBBY) {
+                    auto player = m_GameState.players.find(id);
+                    if (player != m_GameState.players.end()) {
+                        LOG_WARNING("Client", id, "already has name:", player->second.name);
+                        return;
+                    }
+
+                    rejoin(id, name);
+                    return;
+                }
+
                 if (!m_GameState.players[id].name.empty()) {
                     LOG_WARNING("Client", id, "already has name:", m_GameState.players[id].name);
                     return;
@@ -322,6 +444,32 @@ void Server::start() {
             })
     );
 
+    m_SocketServer.addReceiveCallback(
+            C2S_VIEW_PACKET,
+            std::function<void(ID_t, int, int, int, int)>([this](ID_t sender, int minX, int minY, int maxX, int maxY) {
+                if (m_GameState.gameStage != GAME) {
+                    LOG_WARNING("Client", sender, "sent a view but game stage is not game");
+                    return;
+                }
+
+                // lockstep clients already have the whole map
+                if (m_Lockstep) return;
+
+                m_ChunkStreamer.setView(sender, ChunkRect{ minX, minY, maxX, maxY }, m_EnteredChunks, m_LeftChunks);
+
+                if (!m_LeftChunks.empty()) {
+                    m_SocketServer.send(sender, Networking::createPacket<S2C_CHUNK_UNLOAD_PACKET>(m_LeftChunks));
+                }
+
+                m_PlayerUpdates.clear();
+                for (uint32_t chunk: m_EnteredChunks) appendChunk(chunk, m_PlayerUpdates);
+
+                if (!m_PlayerUpdates.empty()) {
+                    m_SocketServer.send(sender, Networking::createPacket<S2C_ENTITY_UPDATES_PACKET>(m_PlayerUpdates));
+                }
+            })
+    );
+
     m_SocketServer.addReceiveCallback(
             C2S_HARVEST_PACKET,
             std::function<void(ID_t, NetworkID)>([this](ID_t sender, NetworkID farmId) {
@@ -330,7 +478,17 @@ void Server::start() {
                     return;
                 }
 
-                entt::entity entity = m_GameState.NEP.get(farmId.id);
+                if (m_Lockstep) {
+                    LOG_WARNING("Client", sender, "sent a direct command in lockstep mode");
+                    return;
+                }
+
+                entt::entity entity = m_GameState.NEP.get(farmId);
+                if (entity == entt::null || !m_GameState.registry.all_of<Farm, Structure>(entity)) {
+                    LOG_WARNING("Client", sender, "tried to harvest an unknown farm", farmId.id);
+                    return;
+                }
+
                 auto& farm = m_GameState.registry.get<Farm>(entity);
                 auto& structure = m_GameState.registry.get<Structure>(entity);
 
@@ -360,12 +518,17 @@ void Server::start() {
                     return;
                 }
 
-                if (x < 0 || x >= m_GameState.mapInfo.size || y < 0 || y >= m_GameState.mapInfo.size) {
+                if (m_Lockstep) {
+                    LOG_WARNING("Client", sender, "sent a direct command in lockstep mode");
+                    return;
+                }
+
+                if (!m_GameState.mapInfo.inBounds(x, y)) {
                     LOG_WARNING("Client", sender, "tried to place wall out of bounds");
                     return;
                 }
 
-                if (m_GameState.mapInfo.structures[y][x] != entt::null) {
+                if (m_GameState.mapInfo.structureAt(x, y) != entt::null) {
                     LOG_WARNING("Client", sender, "tried to place wall on occupied space");
                     return;
                 }
@@ -374,6 +537,12 @@ void Server::start() {
                     return;
                 }
 
+                NetworkID networkId = m_GameState.networkIds.allocate();
+                if (networkId.id == NETWORK_ID_NULL) {
+                    LOG_WARNING("Client", sender, "tried to place wall but the server ran out of network ids");
+                    return;
+                }
+
                 m_GameState.players[sender].gold -= 10;
                 m_SocketServer.send(
                         sender,
@@ -381,7 +550,7 @@ void Server::start() {
                 );
 
                 auto wall = m_GameState.registry.create();
-                m_GameState.registry.emplace<NetworkID>(wall, m_GameState.networkId++);
+                m_GameState.registry.emplace<NetworkID>(wall, networkId);
                 m_GameState.registry.emplace<Structure>(
                         wall,
                         Structure{
@@ -403,12 +572,17 @@ void Server::start() {
                     return;
                 }
 
-                if (x < 0 || x >= m_GameState.mapInfo.size || y < 0 || y >= m_GameState.mapInfo.size) {
+                if (m_Lockstep) {
+                    LOG_WARNING("Client", sender, "sent a direct command in lockstep mode");
+                    return;
+                }
+
+                if (!m_GameState.mapInfo.inBounds(x, y)) {
                     LOG_WARNING("Client", sender, "tried to place wall out of bounds");
                     return;
                 }
 
-                if (m_GameState.mapInfo.structures[y][x] != entt::null) {
+                if (m_GameState.mapInfo.structureAt(x, y) != entt::null) {
                     LOG_WARNING("Client", sender, "tried to place wall on occupied space");
                     return;
                 }
@@ -417,6 +591,12 @@ void Server::start() {
                     return;
                 }
 
+                NetworkID networkId = m_GameState.networkIds.allocate();
+                if (networkId.id == NETWORK_ID_NULL) {
+                    LOG_WARNING("Client", sender, "tried to place farm but the server ran out of network ids");
+                    return;
+                }
+
                 m_GameState.players[sender].gold -= 100;
                 m_SocketServer.send(
                         sender,
@@ -424,7 +604,7 @@ void Server::start() {
                 );
 
                 auto farm = m_GameState.registry.create();
-                m_GameState.registry.emplace<NetworkID>(farm, m_GameState.networkId++);
+                m_GameState.registry.emplace<NetworkID>(farm, networkId);
                 m_GameState.registry.emplace<Structure>(
                         farm,
                         Structure{
@@ -447,7 +627,12 @@ void Server::start() {
                     return;
                 }
 
-                if (x < 0 || x >= m_GameState.mapInfo.size * 32 || y < 0 || y >= m_GameState.mapInfo.size * 32) {
+                if (m_Lockstep) {
+                    LOG_WARNING("Client", sender, "sent a direct command in lockstep mode");
+                    return;
+                }
+
+                if (x < 0 || x >= m_GameState.mapInfo.size * 32.f || y < 0 || y >= m_GameState.mapInfo.size * 32.f) {
                     LOG_WARNING("Client", sender, "tried to place wall out of bounds");
                     return;
                 }
@@ -456,6 +641,12 @@ void Server::start() {
                     return;
                 }
 
+                NetworkID networkId = m_GameState.networkIds.allocate();
+                if (networkId.id == NETWORK_ID_NULL) {
+                    LOG_WARNING("Client", sender, "tried to spawn a soldier but the server ran out of network ids");
+                    return;
+                }
+
                 m_GameState.players[sender].gold -= 100;
                 m_SocketServer.send(
                         sender,
@@ -463,8 +654,9 @@ void Server::start() {
                 );
 
                 auto soldier = m_GameState.registry.create();
-                m_GameState.registry.emplace<NetworkID>(soldier, m_GameState.networkId++);
+                m_GameState.registry.emplace<NetworkID>(soldier, networkId);
                 m_GameState.registry.emplace<Position>(soldier, x, y);
+                m_GameState.registry.emplace<Velocity>(soldier);
                 m_GameState.registry.emplace<Soldier>(
                         soldier,
                         Soldier(
@@ -475,14 +667,35 @@ void Server::start() {
             })
     );
 
-    m_SocketServer.start();
-    if (!m_SocketServer.isListenThreadRunning()) {
-        LOG_WARNING("Failed to start socket server thread");
-        return;
-    }
+    m_SocketServer.addReceiveCallback(
+            C2S_COMMAND_PACKET,
+            std::function<void(ID_t, Command)>([this](ID_t sender, Command command) {
+                if (!m_Lockstep || !m_Simulation.running()) {
+                    LOG_WARNING("Client", sender, "sent a command but the game isn't in lockstep mode");
+                    return;
+                }
+
+                command.player = sender;
+                m_PendingCommands.push_back(command);
+            })
+    );
+
+    m_SocketServer.addReceiveCallback(
+            C2S_STATE_HASH_PACKET,
+            std::function<void(ID_t, uint32_t, uint64_t)>([this](ID_t sender, uint32_t tick, uint64_t hash) {
+                // no hashes to compare against outside lockstep, quietly so a client can't flood the log
+                if (!m_Lockstep || !m_Simulation.running()) return;
+
+                const auto& [ownTick, ownHash] = m_StateHashes[(tick / Lockstep::HASH_INTERVAL) % m_StateHashes.size()];
+                // too old to check
+                if (ownTick != tick) return;
+
+                if (ownHash != hash) {
+                    LOG_WARNING("Client", sender, "desynced at tick", tick);
+                }
+            })
+    );
 
-    m_IsRunning = true;
-    LOG_INFO("Server started");
 }
 
 void Server::stop() {
@@ -503,20 +716,118 @@ void Server::tick(double deltaTime) {
         return;
     }
 
+    PROFILE_SCOPE("Server::tick");
+
+    m_TickProfile = {};
+    Utils::Timers::Stopwatch stopwatch;
+
     m_SocketServer.handleCallbacks();
+    m_TickProfile.callbacks = stopwatch.lap();
+
+    if (m_Lockstep) {
+        if (m_Simulation.running()) tickLockstep();
+        m_TickProfile.lockstep = stopwatch.lap();
+    } else {
+        tickSystems(deltaTime, stopwatch);
+    }
+
+    // only the snapshot happens here, the write runs on the checkpoint thread. while it's still busy with the
+    // previous one the snapshot is skipped too, a slow disk shouldn't cost a world copy every interval
+    if (m_Checkpoints.enabled() && m_GameState.gameStage == GAME && m_Tick % m_CheckpointInterval == 0) {
+        if (m_Checkpoints.busy()) {
+            LOG_WARNING("Previous checkpoint is still being written, skipping tick", m_Tick);
+        } else {
+            PROFILE_SCOPE("Checkpoint::save");
+            Checkpoint::save(m_GameState, m_Tick, m_CheckpointBuffer);
+            m_Checkpoints.submit(m_CheckpointBuffer);
+        }
+    }
+    m_TickProfile.checkpoint = stopwatch.lap();
 
+    updateMetrics();
+
+    // closes the tick in the journal, everything recorded since the last one gets replayed before it
+    m_Journal.tick(m_Tick, static_cast<float>(deltaTime));
+    m_Tick++;
+}
+
+void Server::tickSystems(double deltaTime, Utils::Timers::Stopwatch& stopwatch) {
     bool updatePositions = m_PositionUpdateTimer.timeReached(deltaTime);
 
+    for (auto& grown: m_GrownFarms) grown.clear();
+
+    // systems below only touch the components of their own entities, anything that fires
+    // registry signals or sends packets is collected per worker and done in the commit phase
     {
-        auto view = m_GameState.registry.view<Farm>();
-        for (auto entity: view) {
-            auto& farm = view.get<Farm>(entity);
-            if (farm.state == FarmState::HARVEST) {
-                continue;
+        PROFILE_SCOPE("Server::farms");
+        auto& farms = m_GameState.registry.storage<Farm>();
+
+        m_Jobs.parallelFor(farms.size(), 256, [&](std::size_t begin, std::size_t end, std::size_t worker) {
+            for (std::size_t i = begin; i < end; i++) {
+                entt::entity entity = farms.data()[i];
+                auto& farm = farms.get(entity);
+                if (farm.state == FarmState::HARVEST) {
+                    continue;
+                }
+
+                farm.time++;
+                if (farm.time >= farm.growTime) {
+                    m_GrownFarms[worker].push_back(entity);
+                }
             }
+        });
+    }
+    m_TickProfile.farms = stopwatch.lap();
+
+    {
+        PROFILE_SCOPE("Server::soldiers");
+
+        m_SoldierBuffers.gather(m_GameState.registry);
+        std::size_t count = m_SoldierBuffers.size();
+        m_TickProfile.soldierGather = stopwatch.lap();
+
+        // --- SOLDIER AI ---
+
+        // --- SOLDIER AI ---
+
+        // nothing steers soldiers yet, gather leaves prefX/prefY at zero and avoidance only keeps them apart.
+        // whatever picks their direction has to run SoldierKernels::normalize and scale by SOLDIER_SPEED here
+
+        m_SoldierGrid.build(m_SoldierBuffers.x.data(), m_SoldierBuffers.y.data(), count);
+
+        auto deadline = std::chrono::steady_clock::now() + m_AvoidanceSettings.budget;
+        std::atomic<std::size_t> skipped = 0;
+
+        m_Jobs.parallelFor(count, 64, [&](std::size_t begin, std::size_t end, std::size_t) {
+            PROFILE_SCOPE("Avoidance::computeVelocities");
+            skipped += Avoidance::computeVelocities(
+                    m_SoldierBuffers, m_SoldierGrid, m_GameState.mapInfo, m_AvoidanceSettings,
+                    (float) deltaTime, deadline, begin, end
+            );
+        });
+
+        if (skipped > 0) {
+            LOG_WARNING("Avoidance ran out of time,", skipped.load(), "soldiers were only pushed apart");
+        }
 
-            farm.time++;
-            if (farm.time >= farm.growTime) {
+        m_SoldierBuffers.vx.swap(m_SoldierBuffers.nextVx);
+        m_SoldierBuffers.vy.swap(m_SoldierBuffers.nextVy);
+        m_TickProfile.avoidance = stopwatch.lap();
+
+        SoldierKernels::integrate(
+                m_SoldierBuffers.x.data(), m_SoldierBuffers.y.data(),
+                m_SoldierBuffers.vx.data(), m_SoldierBuffers.vy.data(),
+                (float) deltaTime, count
+        );
+        m_TickProfile.integrate = stopwatch.lap();
+    }
+
+    // commit phase
+    {
+        PROFILE_SCOPE("Server::commit");
+
+        for (auto& grown: m_GrownFarms) {
+            for (auto entity: grown) {
                 m_GameState.registry.patch<Farm>(
                         entity,
                         [](Farm& f) {
@@ -526,31 +837,155 @@ void Server::tick(double deltaTime) {
                 );
             }
         }
+
+        for (std::size_t i = 0; i < m_SoldierBuffers.size(); i++) {
+            entt::entity entity = m_SoldierBuffers.entities[i];
+            if (m_SoldierBuffers.scatter(m_GameState.registry, i) && !m_MovedSoldiers.contains(entity)) {
+                m_MovedSoldiers.push(entity);
+            }
+        }
+
+        if (updatePositions) {
+            for (auto entity: m_MovedSoldiers) {
+                if (!m_GameState.registry.valid(entity)) continue;
+                markDirty(m_GameState.registry, entity, UPDATE_POSITION);
+            }
+            m_MovedSoldiers.clear();
+        }
     }
+    m_TickProfile.commit = stopwatch.lap();
 
-    {
-        auto view = m_GameState.registry.view<Soldier, Position, NetworkID>();
-        view.each([&](auto entity, auto& soldier, auto& position, auto& networkID) {
-            float velocity = deltaTime * 32.f * 3;
+    flushDirty();
+    m_TickProfile.replication = stopwatch.lap();
+}
+
+void Server::tickLockstep() {
+    uint32_t tick = m_Simulation.tick();
 
-            sf::Vector2f direction;
+    m_SocketServer.sendAll(Networking::createPacket<S2C_COMMAND_FRAME_PACKET>(tick, m_PendingCommands));
+    m_Simulation.step(m_PendingCommands);
+    m_PendingCommands.clear();
 
-            // --- SOLDIER AI ---
+    // clients report the hash after stepping the tick, so it's stored under the tick that was just simulated
+    if (tick % Lockstep::HASH_INTERVAL == 0) {
+        m_StateHashes[(tick / Lockstep::HASH_INTERVAL) % m_StateHashes.size()] = { tick, m_Simulation.hash() };
+    }
+}
 
-            // --- SOLDIER AI ---
+void Server::flushDirty() {
+    PROFILE_SCOPE("Server::flushDirty");
 
-            if (direction.x != 0 && direction.y != 0) {
-                direction = direction.normalized();
+    if (m_DirtySet.empty()) return;
 
-                position.x += direction.x * velocity;
-                position.y += direction.y * velocity;
+    collectDirty(m_EntityUpdates, m_EntityUpdateChunks);
+    if (m_EntityUpdates.empty()) return;
 
-                if (updatePositions) {
-                    m_SocketServer.sendAll(Networking::createPacket<S2C_SOLDIER_POSITION_PACKET>(networkID, position));
-                }
+    for (const auto& [player, view]: m_ChunkStreamer.views()) {
+        filterVisible(player, m_PlayerUpdates);
+
+        if (!m_PlayerUpdates.empty()) {
+            m_SocketServer.send(player, Networking::createPacket<S2C_ENTITY_UPDATES_PACKET>(m_PlayerUpdates));
+        }
+    }
+}
+
+void Server::filterVisible(ID_t player, std::vector<EntityUpdate>& out) const {
+    out.clear();
+
+    for (std::size_t i = 0; i < m_EntityUpdates.size(); i++) {
+        if (m_ChunkStreamer.isVisible(player, m_EntityUpdateChunks[i])) out.push_back(m_EntityUpdates[i]);
+    }
+}
+
+void Server::appendChunk(uint32_t chunk, std::vector<EntityUpdate>& out) const {
+    const auto& mapInfo = m_GameState.mapInfo;
+    const auto& registry = m_GameState.registry;
+
+    const MapChunk *mapChunk = mapInfo.chunk(chunk);
+    if (!mapChunk) return;
+
+    int originX = static_cast<int>(chunk % mapInfo.chunksPerSide()) * MAP_CHUNK_SIZE;
+    int originY = static_cast<int>(chunk / mapInfo.chunksPerSide()) * MAP_CHUNK_SIZE;
+
+    for (int i = 0; i < MAP_CHUNK_SIZE * MAP_CHUNK_SIZE; i++) {
+        entt::entity entity = mapChunk->structures[i];
+        if (entity == entt::null) continue;
+
+        // bigger structures cover several tiles, only send them from their top left one
+        const auto& structure = registry.get<Structure>(entity);
+        if (structure.x != originX + i % MAP_CHUNK_SIZE || structure.y != originY + i / MAP_CHUNK_SIZE) continue;
+
+        const auto& networkId = registry.get<NetworkID>(entity);
+        // created this tick, goes out with the dirty updates
+        if (m_DirtySet.flagsOf(networkId) & UPDATE_STRUCTURE_CREATED) continue;
+
+        EntityUpdate update{ .id = networkId, .flags = UPDATE_STRUCTURE_CREATED, .structure = structure };
+        if (const auto *farm = registry.try_get<Farm>(entity)) {
+            update.flags |= UPDATE_FARM;
+            update.farm = *farm;
+        }
+
+        out.push_back(update);
+    }
+}
+
+void Server::appendSoldiers(std::vector<EntityUpdate>& out) const {
+    const auto& registry = m_GameState.registry;
+
+    for (auto [entity, soldier, position, networkId]: registry.view<Soldier, Position, NetworkID>().each()) {
+        // created this tick, goes out with the dirty updates
+        if (m_DirtySet.flagsOf(networkId) & UPDATE_SOLDIER_CREATED) continue;
+
+        out.push_back({ .id = networkId, .flags = UPDATE_SOLDIER_CREATED, .soldier = soldier, .position = position });
+    }
+}
+
+void Server::collectDirty(std::vector<EntityUpdate>& updates, std::vector<uint32_t>& chunks) {
+    auto& registry = m_GameState.registry;
+    updates.clear();
+    chunks.clear();
+
+    for (const auto& entry: m_DirtySet.entries()) {
+        uint8_t flags = entry.flags;
+
+        if (flags & UPDATE_DELETED) {
+            // clients never saw it
+            if (flags & (UPDATE_STRUCTURE_CREATED | UPDATE_SOLDIER_CREATED)) continue;
+
+            updates.push_back({ .id = entry.id, .flags = UPDATE_DELETED });
+            chunks.push_back(entry.chunk);
+            continue;
+        }
+
+        if (!registry.valid(entry.entity)) continue;
+
+        EntityUpdate update{ .id = entry.id, .flags = flags };
+
+        if (flags & UPDATE_STRUCTURE_CREATED) update.structure = registry.get<Structure>(entry.entity);
+
+        if (flags & UPDATE_FARM) {
+            const auto *farm = registry.try_get<Farm>(entry.entity);
+            if (farm) update.farm = *farm;
+            else update.flags &= ~UPDATE_FARM;
+        }
+
+        if (flags & UPDATE_SOLDIER_CREATED) update.soldier = registry.get<Soldier>(entry.entity);
+
+        if (flags & (UPDATE_SOLDIER_CREATED | UPDATE_POSITION)) {
+            const auto *position = registry.try_get<Position>(entry.entity);
+            if (position) {
+                update.position = *position;
+            } else {
+                LOG_WARNING("Soldier has no Position");
+                continue;
             }
-        });
+        }
+
+        updates.push_back(update);
+        chunks.push_back(entry.chunk);
     }
+
+    m_DirtySet.clear();
 }
 
 void Server::run() {
@@ -579,6 +1014,7 @@ void Server::run() {
         }
 
         tick(deltaTime);
+        Utils::Profiler::pollDump();
         tickTimer.sleep();
     }
 }
\ No newline at end of file
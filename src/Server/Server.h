@@ -1,17 +1,51 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <string>
+#include <unordered_map>
 #include "SFML/Network/IpAddress.hpp"
 #include "Networking/SocketServer.h"
 #include "Packets.h"
 #include "ServerGameState.h"
 #include "NetworkEntityMap.h"
 #include "Soldier.h"
+#include "SoldierBuffers.h"
+#include "DirtySet.h"
+#include "EntityUpdate.h"
+#include "MapTemplate.h"
+#include "SpatialGrid.h"
+#include "Avoidance.h"
+#include "ChunkStreamer.h"
 #include "Utils/Timers.h"
+#include "Utils/Metrics.h"
+#include "Utils/JobSystem.h"
+#include "Lockstep/Simulation.h"
+#include "InputJournal.h"
+#include "Checkpoint.h"
+
+// milliseconds each part of the last tick took
+struct TickProfile {
+    double callbacks = 0.0;
+    double farms = 0.0;
+    double soldierGather = 0.0;
+    double avoidance = 0.0;
+    double integrate = 0.0;
+    double commit = 0.0;
+    double replication = 0.0;
+    double lockstep = 0.0;
+    double checkpoint = 0.0;
+
+    [[nodiscard]] double total() const {
+        return callbacks + farms + soldierGather + avoidance + integrate + commit + replication + lockstep +
+               checkpoint;
+    }
+};
 
 class Server {
 public:
-    Server(sf::IpAddress ip, uint16_t port);
+    // in lockstep mode clients run the simulation themselves and only commands are sent around
+    Server(sf::IpAddress ip, uint16_t port, bool lockstep = false);
     ~Server();
 
     bool isRunning() const { return m_IsRunning; };
@@ -19,24 +53,43 @@ public:
     void start();
     void stop();
 
+    // journals every client event from now on
+    bool openJournal(const std::string& path);
+    // feeds a journal through a headless server as fast as possible and logs tick timings
+    bool replay(const std::string& path);
+    // restores the checkpoint at path on start if there is one and snapshots the game there every interval ticks.
+    // the players of a restored game get their place back by connecting with the name they had
+    void enableCheckpoints(const std::string& path, uint32_t interval);
+    // exposes tick, network and entity metrics over http on localhost, or as a file rewritten every few seconds
+    bool serveMetrics(uint16_t port);
+    void writeMetrics(const std::string& path);
+
     void tick(double deltaTime);
     void run();
 
+    [[nodiscard]] const TickProfile& tickProfile() const { return m_TickProfile; }
+
 private:
+    // drives a synthetic match through the same setup and packet handlers as real clients
+    friend class ServerBench;
+
+
+    // map template, registry signals and packet callbacks
+    void setup();
+    void tickSystems(double deltaTime, Utils::Timers::Stopwatch& stopwatch);
+    void restoreCheckpoint();
+    // gives a client that connected to a running game the place of the player that left it under that name
+    void rejoin(ID_t client, const std::string& name);
+    void updateMetrics();
+
     void onCreateStructure(entt::registry& registry, entt::entity entity) {
         Structure& structureComponent = registry.get<Structure>(entity);
 
         for (int i = 0; i < structureComponent.size; i++)
             for (int j = 0; j < structureComponent.size; j++)
-                m_GameState.mapInfo.structures[structureComponent.y + i][structureComponent.x + j] = entity;
-
-        NetworkID *networkIdComponent = registry.try_get<NetworkID>(entity);
-        if (!networkIdComponent) {
-            LOG_WARNING("Structure has no NetworkID");
-            return;
-        }
+                m_GameState.mapInfo.setStructure(structureComponent.x + j, structureComponent.y + i, entity);
 
-        m_SocketServer.sendAll(Networking::createPacket<S2C_STRUCTURE_PACKET>(*networkIdComponent, structureComponent));
+        markDirty(registry, entity, UPDATE_STRUCTURE_CREATED);
     }
 
     void onDeleteStructure(entt::registry& registry, entt::entity entity) {
@@ -44,56 +97,54 @@ private:
 
         for (int i = 0; i < structureComponent.size; i++)
             for (int j = 0; j < structureComponent.size; j++)
-                m_GameState.mapInfo.structures[structureComponent.y + i][structureComponent.x + j] = entt::null;
+                m_GameState.mapInfo.setStructure(structureComponent.x + j, structureComponent.y + i, entt::null);
 
-        NetworkID *networkIdComponent = registry.try_get<NetworkID>(entity);
-        if (!networkIdComponent) {
-            LOG_WARNING("Structure has no NetworkID");
-            return;
-        }
-
-        m_SocketServer.sendAll(Networking::createPacket<S2C_STRUCTURE_DELETE_PACKET>(*networkIdComponent));
+        markDirty(registry, entity, UPDATE_DELETED);
     }
 
     void onUpdateFarm(entt::registry& registry, entt::entity entity) {
-        Farm& farmComponent = registry.get<Farm>(entity);
+        markDirty(registry, entity, UPDATE_FARM);
+    }
 
-        NetworkID *networkIdComponent = registry.try_get<NetworkID>(entity);
-        if (!networkIdComponent) {
-            LOG_WARNING("Farm has no NetworkID");
-            return;
-        }
+    void onCreateSoldier(entt::registry& registry, entt::entity entity) {
+        markDirty(registry, entity, UPDATE_SOLDIER_CREATED);
+    }
 
-        m_SocketServer.sendAll(Networking::createPacket<S2C_FARM_PACKET>(*networkIdComponent, farmComponent));
+    void onDeleteSoldier(entt::registry& registry, entt::entity entity) {
+        markDirty(registry, entity, UPDATE_DELETED);
     }
 
-    void onCreateSoldier(entt::registry& registry, entt::entity entity) {
-        Soldier& soldierComponent = registry.get<Soldier>(entity);
+    void markDirty(entt::registry& registry, entt::entity entity, uint8_t flags) {
+        // clients simulate everything themselves once the game is running
+        if (m_Lockstep && m_Simulation.running()) return;
 
         NetworkID *networkIdComponent = registry.try_get<NetworkID>(entity);
         if (!networkIdComponent) {
-            LOG_WARNING("Soldier has no NetworkID");
+            LOG_WARNING("Entity has no NetworkID");
             return;
         }
 
-        Position *positionComponent = registry.try_get<Position>(entity);
-        if (!positionComponent) {
-            LOG_WARNING("Soldier has no Position");
-            return;
-        }
+        // structures are only replicated to players that see their chunk
+        uint32_t chunk = MAP_CHUNK_NONE;
+        if (const auto *structure = registry.try_get<Structure>(entity))
+            chunk = m_GameState.mapInfo.chunkIndex(structure->x, structure->y);
 
-        m_SocketServer.sendAll(Networking::createPacket<S2C_SOLDIER_CREATE_PACKET>(*networkIdComponent, soldierComponent, *positionComponent));
+        m_DirtySet.mark(entity, *networkIdComponent, flags, chunk);
     }
 
-    void onDeleteSoldier(entt::registry& registry, entt::entity entity) {
-        NetworkID *networkIdComponent = registry.try_get<NetworkID>(entity);
-        if (!networkIdComponent) {
-            LOG_WARNING("Soldier has no NetworkID");
-            return;
-        }
+    // sends everything that changed this tick as one S2C_ENTITY_UPDATES_PACKET per player
+    void flushDirty();
+    // turns the dirty set into updates and the chunk of each update and clears it
+    void collectDirty(std::vector<EntityUpdate>& updates, std::vector<uint32_t>& chunks);
+    // the updates the player can see
+    void filterVisible(ID_t player, std::vector<EntityUpdate>& out) const;
+    // creation updates for every structure whose top left tile is in the chunk
+    void appendChunk(uint32_t chunk, std::vector<EntityUpdate>& out) const;
+    // creation updates for every soldier, for players that join a game in progress
+    void appendSoldiers(std::vector<EntityUpdate>& out) const;
 
-        m_SocketServer.sendAll(Networking::createPacket<S2C_SOLDIER_DELETE_PACKET>(*networkIdComponent));
-    }
+    // broadcasts this tick's commands and steps the shared simulation
+    void tickLockstep();
 
     Networking::SocketServer m_SocketServer;
 
@@ -103,6 +154,46 @@ private:
     std::atomic<bool> m_IsRunning;
 
     ServerGameState m_GameState;
+    MapTemplate m_MapTemplate;
 
     Utils::Timers::NonBlockingTimer<10> m_PositionUpdateTimer;
+
+    Utils::JobSystem m_Jobs;
+    std::vector<std::vector<entt::entity>> m_GrownFarms;
+
+    SoldierBuffers m_SoldierBuffers;
+    SpatialGrid m_SoldierGrid{ 64.f };
+    AvoidanceSettings m_AvoidanceSettings{ .maxSpeed = SOLDIER_SPEED };
+    // soldiers that moved since the last position update
+    entt::sparse_set m_MovedSoldiers;
+
+    DirtySet m_DirtySet;
+    std::vector<EntityUpdate> m_EntityUpdates;
+    std::vector<uint32_t> m_EntityUpdateChunks;
+    std::vector<EntityUpdate> m_PlayerUpdates;
+
+    ChunkStreamer m_ChunkStreamer;
+    // players of the running game that aren't connected, by name, they get their place back by joining with it
+    std::unordered_multimap<std::string, ID_t> m_RejoinNames;
+    std::vector<uint32_t> m_EnteredChunks;
+    std::vector<uint32_t> m_LeftChunks;
+
+    bool m_Lockstep;
+    Lockstep::Simulation m_Simulation;
+    std::vector<Command> m_PendingCommands;
+    // our own hash of recent ticks to check what clients report against
+    std::array<std::pair<uint32_t, uint64_t>, 64> m_StateHashes{};
+
+    uint32_t m_Tick = 0;
+    TickProfile m_TickProfile;
+    InputJournalWriter m_Journal;
+
+    std::string m_CheckpointPath;
+    uint32_t m_CheckpointInterval = 0;
+    CheckpointWriter m_Checkpoints;
+    std::vector<char> m_CheckpointBuffer;
+
+    // one exporter runs one thread, http and the file can both be enabled
+    Utils::Metrics::Exporter m_MetricsServer;
+    Utils::Metrics::Exporter m_MetricsFile;
 };
@@ -0,0 +1,177 @@
+#include "ServerBench.h"
+#include "Server.h"
+#include "logy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr double TICK_TIME = 1.0 / 20.0;
+
+struct Summary {
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+Summary summarize(std::vector<double> samples) {
+    Summary summary;
+    if (samples.empty()) return summary;
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+    };
+
+    for (double sample: samples) summary.mean += sample;
+    summary.mean /= static_cast<double>(samples.size());
+    summary.p50 = percentile(0.5);
+    summary.p99 = percentile(0.99);
+    summary.max = samples.back();
+    return summary;
+}
+
+void printSummary(const char *name, const Summary& summary, bool last) {
+    std::printf("    \"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+                name, summary.mean, summary.p50, summary.p99, summary.max, last ? "" : ",");
+}
+}
+
+bool ServerBench::run() {
+    const Config& config = m_Config;
+    if (config.players == 0 || config.ticks == 0) {
+        LOG_WARNING("Server bench needs at least one player and one tick");
+        return false;
+    }
+
+    Server server(sf::IpAddress::LocalHost, 0);
+    server.setup();
+    server.m_SocketServer.startHeadless();
+    server.m_IsRunning = true;
+
+    // every base gets a square big enough for its structures next to the template's own layout
+    MapTemplate& map = server.m_MapTemplate;
+    map.basesPerRow = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(config.players))));
+    map.baseSpacing = std::max(map.baseSpacing, static_cast<int>(std::ceil(std::sqrt(config.structures * 2.0))) + 4);
+    map.mapSize = std::max(map.mapSize, static_cast<uint32_t>(map.basesPerRow * map.baseSpacing));
+
+    for (ID_t player = 0; player < config.players; player++) {
+        server.m_SocketServer.injectConnected(player);
+        server.m_SocketServer.injectPacket(
+                player, Networking::createPacket<C2S_NAME_PACKET>("bot" + std::to_string(player))
+        );
+    }
+    server.tick(TICK_TIME);
+
+    for (ID_t player = 0; player < config.players; player++) {
+        server.m_SocketServer.injectPacket(player, Networking::createPacket<C2S_READY_PACKET>(true));
+    }
+    server.tick(TICK_TIME);
+
+    ServerGameState& state = server.m_GameState;
+    if (state.gameStage != GAME) {
+        LOG_WARNING("Server bench match didn't start");
+        return false;
+    }
+
+    std::mt19937 random(config.seed);
+    const MapInfo& mapInfo = state.mapInfo;
+    const int spacing = map.baseSpacing;
+    const int chunkTiles = static_cast<int>(MAP_CHUNK_SIZE);
+
+    for (ID_t player = 0; player < config.players; player++) {
+        // enough to pay for everything below
+        state.players[player].gold = 1 << 30;
+
+        int baseX = static_cast<int>(player % map.basesPerRow) * spacing;
+        int baseY = static_cast<int>(player / map.basesPerRow) * spacing;
+
+        // each bot looks at its own base
+        server.m_SocketServer.injectPacket(player, Networking::createPacket<C2S_VIEW_PACKET>(
+                baseX / chunkTiles - 1, baseY / chunkTiles - 1,
+                (baseX + spacing) / chunkTiles + 1, (baseY + spacing) / chunkTiles + 1
+        ));
+
+        uint32_t placed = 0;
+        for (int y = baseY; y < baseY + spacing && placed < config.structures; y++) {
+            for (int x = baseX; x < baseX + spacing && placed < config.structures; x++) {
+                // every other tile so the soldiers have room to walk between them
+                if ((x + y) % 2 != 0 || !mapInfo.inBounds(x, y) || mapInfo.structureAt(x, y) != entt::null)
+                    continue;
+
+                if (placed % 2 == 0)
+                    server.m_SocketServer.injectPacket(player, Networking::createPacket<C2S_PLANT_FARM_PACKET>(x, y));
+                else
+                    server.m_SocketServer.injectPacket(player, Networking::createPacket<C2S_PLACE_WALL_PACKET>(x, y));
+                placed++;
+            }
+        }
+
+        if (placed < config.structures) {
+            LOG_WARNING("Only", placed, "structures fit into the base of bot", player);
+        }
+
+        std::uniform_real_distribution<float> randomX(baseX * 32.f, (baseX + spacing) * 32.f - 1.f);
+        std::uniform_real_distribution<float> randomY(baseY * 32.f, (baseY + spacing) * 32.f - 1.f);
+        for (uint32_t i = 0; i < config.soldiers; i++) {
+            server.m_SocketServer.injectPacket(
+                    player, Networking::createPacket<C2S_SPAWN_SOLDIER_PACKET>(randomX(random), randomY(random))
+            );
+        }
+    }
+
+    for (uint32_t i = 0; i < config.warmupTicks + 1; i++) server.tick(TICK_TIME);
+
+    std::vector<double> tickTimes;
+    std::vector<TickProfile> profiles;
+    tickTimes.reserve(config.ticks);
+    profiles.reserve(config.ticks);
+
+    Utils::Timers::Stopwatch total;
+    for (uint32_t i = 0; i < config.ticks; i++) {
+        Utils::Timers::Stopwatch stopwatch;
+        server.tick(TICK_TIME);
+        tickTimes.push_back(stopwatch.lap());
+        profiles.push_back(server.tickProfile());
+    }
+    double seconds = total.lap() / 1000.0;
+
+    server.m_IsRunning = false;
+
+    auto system = [&profiles](double TickProfile::*field) {
+        std::vector<double> samples;
+        samples.reserve(profiles.size());
+        for (const auto& profile: profiles) samples.push_back(profile.*field);
+        return summarize(std::move(samples));
+    };
+
+    std::printf("{\n");
+    std::printf("  \"config\": { \"players\": %u, \"structures\": %u, \"soldiers\": %u, \"ticks\": %u, "
+                "\"warmup_ticks\": %u, \"seed\": %u, \"map_size\": %u },\n",
+                config.players, config.structures, config.soldiers, config.ticks, config.warmupTicks, config.seed,
+                mapInfo.size);
+    std::printf("  \"entities\": { \"structures\": %zu, \"soldiers\": %zu },\n",
+                state.registry.storage<Structure>().size(), state.registry.storage<Soldier>().size());
+    std::printf("  \"ticks_per_second\": %.2f,\n", config.ticks / seconds);
+    Summary tick = summarize(tickTimes);
+    std::printf("  \"tick_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+                tick.mean, tick.p50, tick.p99, tick.max);
+    std::printf("  \"systems_ms\": {\n");
+    printSummary("callbacks", system(&TickProfile::callbacks), false);
+    printSummary("farms", system(&TickProfile::farms), false);
+    printSummary("soldier_gather", system(&TickProfile::soldierGather), false);
+    printSummary("avoidance", system(&TickProfile::avoidance), false);
+    printSummary("integrate", system(&TickProfile::integrate), false);
+    printSummary("commit", system(&TickProfile::commit), false);
+    printSummary("replication", system(&TickProfile::replication), false);
+    printSummary("checkpoint", system(&TickProfile::checkpoint), true);
+    std::printf("  }\n");
+    std::printf("}\n");
+
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// runs a synthetic match on a headless server and prints tick timings as json to stdout,
+// the bots go through the same packet handlers real clients do so the whole tick is measured
+class ServerBench {
+public:
+    struct Config {
+        uint32_t players = 4;
+        // per player
+        uint32_t structures = 200;
+        uint32_t soldiers = 250;
+        uint32_t ticks = 1200;
+        // not measured, lets the freshly spawned soldiers spread out
+        uint32_t warmupTicks = 40;
+        uint32_t seed = 1;
+    };
+
+    explicit ServerBench(const Config& config) : m_Config(config) {}
+
+    // false when the match couldn't be set up
+    bool run();
+
+private:
+    Config m_Config;
+};
@@ -10,6 +10,7 @@
 
 #include "entt/entt.hpp"
 #include "NetworkEntityMap.h"
+#include "NetworkIdAllocator.h"
 
 enum GameStage {
     LOBBY,
@@ -23,6 +24,6 @@ struct ServerGameState {
     MapInfo mapInfo;
     entt::registry registry;
 
-    std::atomic<ID_t> networkId = 0;
+    NetworkIdAllocator networkIds;
     NetworkEntityMap NEP;
 };
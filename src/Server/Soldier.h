@@ -4,6 +4,9 @@
 #include "Utils/Utils.h"
 #include "SFML/Network/Packet.hpp"
 
+// pixels per second
+constexpr float SOLDIER_SPEED = 32.f * 3;
+
 enum class SoldierType {
     Basic,
 };
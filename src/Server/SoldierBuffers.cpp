@@ -0,0 +1,74 @@
+#include "SoldierBuffers.h"
+
+#include "Soldier.h"
+#include "Position.h"
+#include "Velocity.h"
+#include "Hitbox.h"
+
+void SoldierBuffers::clear() {
+    resize(0);
+}
+
+void SoldierBuffers::resize(std::size_t count) {
+    entities.resize(count);
+    x.resize(count);
+    y.resize(count);
+    offsetX.resize(count);
+    offsetY.resize(count);
+    vx.resize(count);
+    vy.resize(count);
+    prefX.resize(count);
+    prefY.resize(count);
+    nextVx.resize(count);
+    nextVy.resize(count);
+    radius.resize(count);
+}
+
+void SoldierBuffers::gather(entt::registry& registry) {
+    auto view = registry.view<Soldier, Position>();
+    resize(view.size_hint());
+
+    std::size_t i = 0;
+    view.each([&](auto entity, auto& soldier, auto& position) {
+        entities[i] = entity;
+
+        // the soldier is drawn with its bottom left corner at Position, the hitbox sits at the bottom center
+        const auto *hitbox = registry.try_get<Hitbox>(entity);
+        float sizeX = hitbox ? hitbox->sizeX : soldier.size;
+        float sizeY = hitbox ? hitbox->sizeY : soldier.size / 2.f;
+
+        offsetX[i] = sizeX / 2.f;
+        offsetY[i] = -sizeY / 2.f;
+        x[i] = position.x + offsetX[i];
+        y[i] = position.y + offsetY[i];
+        radius[i] = sizeX / 2.f;
+
+        const auto *velocity = registry.try_get<Velocity>(entity);
+        vx[i] = velocity ? velocity->x : 0.f;
+        vy[i] = velocity ? velocity->y : 0.f;
+
+        prefX[i] = 0.f;
+        prefY[i] = 0.f;
+        nextVx[i] = 0.f;
+        nextVy[i] = 0.f;
+
+        i++;
+    });
+
+    resize(i);
+}
+
+bool SoldierBuffers::scatter(entt::registry& registry, std::size_t i) const {
+    // written in place, replacing it every tick would fire on_update for the whole army
+    auto& velocity = registry.get<Velocity>(entities[i]);
+    velocity.x = vx[i];
+    velocity.y = vy[i];
+
+    // going through the offset and back isn't exact, so only touch positions that actually moved
+    if (vx[i] == 0.f && vy[i] == 0.f) return false;
+
+    auto& position = registry.get<Position>(entities[i]);
+    position.x = x[i] - offsetX[i];
+    position.y = y[i] - offsetY[i];
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "entt/entt.hpp"
+
+// structure-of-arrays copy of the soldier components, so the movement kernels can run over plain float arrays
+struct SoldierBuffers {
+    std::vector<entt::entity> entities;
+
+    // center of the hitbox, offset is what has to be subtracted to get back to Position
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> offsetX;
+    std::vector<float> offsetY;
+
+    // current velocity in pixels per second
+    std::vector<float> vx;
+    std::vector<float> vy;
+
+    // direction the soldier wants to go in, length 0..1
+    std::vector<float> prefX;
+    std::vector<float> prefY;
+
+    // velocity picked by the avoidance for this tick
+    std::vector<float> nextVx;
+    std::vector<float> nextVy;
+
+    std::vector<float> radius;
+
+    [[nodiscard]] std::size_t size() const { return entities.size(); }
+
+    void clear();
+    void resize(std::size_t count);
+
+    // copies every soldier with a Position into the buffers
+    void gather(entt::registry& registry);
+    // writes Position and Velocity of soldier i back, returns false if it didn't move. soldiers get their Velocity
+    // when they're spawned
+    bool scatter(entt::registry& registry, std::size_t i) const;
+};
@@ -0,0 +1,186 @@
+#include "SoldierKernels.h"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace SoldierKernels {
+namespace {
+constexpr float EPSILON = 1e-6f;
+}
+
+const char *instructionSet() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void normalize(float *x, float *y, std::size_t count) {
+    std::size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256 epsilon = _mm256_set1_ps(EPSILON);
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 lengthSquared = _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy));
+        __m256 nonZero = _mm256_cmp_ps(lengthSquared, epsilon, _CMP_GT_OQ);
+        __m256 inverse = _mm256_div_ps(_mm256_set1_ps(1.f), _mm256_sqrt_ps(lengthSquared));
+        inverse = _mm256_and_ps(inverse, nonZero);
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(vx, inverse));
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(vy, inverse));
+    }
+#elif defined(__SSE2__)
+    const __m128 epsilon = _mm_set1_ps(EPSILON);
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 lengthSquared = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+        __m128 nonZero = _mm_cmpgt_ps(lengthSquared, epsilon);
+        __m128 inverse = _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(lengthSquared));
+        inverse = _mm_and_ps(inverse, nonZero);
+        _mm_storeu_ps(x + i, _mm_mul_ps(vx, inverse));
+        _mm_storeu_ps(y + i, _mm_mul_ps(vy, inverse));
+    }
+#endif
+
+    for (; i < count; i++) {
+        float lengthSquared = x[i] * x[i] + y[i] * y[i];
+        if (lengthSquared <= EPSILON) {
+            x[i] = 0.f;
+            y[i] = 0.f;
+            continue;
+        }
+
+        float inverse = 1.f / std::sqrt(lengthSquared);
+        x[i] *= inverse;
+        y[i] *= inverse;
+    }
+}
+
+void integrate(float *x, float *y, const float *vx, const float *vy, float dt, std::size_t count) {
+    std::size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256 delta = _mm256_set1_ps(dt);
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), delta)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(vy + i), delta)));
+    }
+#elif defined(__SSE2__)
+    const __m128 delta = _mm_set1_ps(dt);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), delta)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(vy + i), delta)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+}
+
+void separation(float x, float y, float radius, const float *xs, const float *ys, const float *radii,
+                std::size_t count, float& forceX, float& forceY) {
+    std::size_t j = 0;
+
+#if defined(__AVX2__)
+    const __m256 centerX = _mm256_set1_ps(x);
+    const __m256 centerY = _mm256_set1_ps(y);
+    const __m256 ownRadius = _mm256_set1_ps(radius);
+    const __m256 epsilon = _mm256_set1_ps(EPSILON);
+    __m256 sumX = _mm256_setzero_ps();
+    __m256 sumY = _mm256_setzero_ps();
+
+    for (; j + 8 <= count; j += 8) {
+        __m256 dx = _mm256_sub_ps(centerX, _mm256_loadu_ps(xs + j));
+        __m256 dy = _mm256_sub_ps(centerY, _mm256_loadu_ps(ys + j));
+        __m256 distanceSquared = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        __m256 reach = _mm256_add_ps(ownRadius, _mm256_loadu_ps(radii + j));
+
+        // the soldier itself is at distance 0 and falls out here as well
+        __m256 mask = _mm256_and_ps(
+                _mm256_cmp_ps(distanceSquared, epsilon, _CMP_GT_OQ),
+                _mm256_cmp_ps(distanceSquared, _mm256_mul_ps(reach, reach), _CMP_LT_OQ)
+        );
+        if (_mm256_movemask_ps(mask) == 0) continue;
+
+        __m256 distance = _mm256_sqrt_ps(distanceSquared);
+        __m256 weight = _mm256_div_ps(_mm256_sub_ps(reach, distance), _mm256_mul_ps(reach, distance));
+        weight = _mm256_and_ps(weight, mask);
+
+        sumX = _mm256_add_ps(sumX, _mm256_mul_ps(dx, weight));
+        sumY = _mm256_add_ps(sumY, _mm256_mul_ps(dy, weight));
+    }
+
+    alignas(32) float lanesX[8];
+    alignas(32) float lanesY[8];
+    _mm256_store_ps(lanesX, sumX);
+    _mm256_store_ps(lanesY, sumY);
+    for (int lane = 0; lane < 8; lane++) {
+        forceX += lanesX[lane];
+        forceY += lanesY[lane];
+    }
+#elif defined(__SSE2__)
+    const __m128 centerX = _mm_set1_ps(x);
+    const __m128 centerY = _mm_set1_ps(y);
+    const __m128 ownRadius = _mm_set1_ps(radius);
+    const __m128 epsilon = _mm_set1_ps(EPSILON);
+    __m128 sumX = _mm_setzero_ps();
+    __m128 sumY = _mm_setzero_ps();
+
+    for (; j + 4 <= count; j += 4) {
+        __m128 dx = _mm_sub_ps(centerX, _mm_loadu_ps(xs + j));
+        __m128 dy = _mm_sub_ps(centerY, _mm_loadu_ps(ys + j));
+        __m128 distanceSquared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 reach = _mm_add_ps(ownRadius, _mm_loadu_ps(radii + j));
+
+        // the soldier itself is at distance 0 and falls out here as well
+        __m128 mask = _mm_and_ps(
+                _mm_cmpgt_ps(distanceSquared, epsilon),
+                _mm_cmplt_ps(distanceSquared, _mm_mul_ps(reach, reach))
+        );
+        if (_mm_movemask_ps(mask) == 0) continue;
+
+        __m128 distance = _mm_sqrt_ps(distanceSquared);
+        __m128 weight = _mm_div_ps(_mm_sub_ps(reach, distance), _mm_mul_ps(reach, distance));
+        weight = _mm_and_ps(weight, mask);
+
+        sumX = _mm_add_ps(sumX, _mm_mul_ps(dx, weight));
+        sumY = _mm_add_ps(sumY, _mm_mul_ps(dy, weight));
+    }
+
+    alignas(16) float lanesX[4];
+    alignas(16) float lanesY[4];
+    _mm_store_ps(lanesX, sumX);
+    _mm_store_ps(lanesY, sumY);
+    for (int lane = 0; lane < 4; lane++) {
+        forceX += lanesX[lane];
+        forceY += lanesY[lane];
+    }
+#endif
+
+    for (; j < count; j++) {
+        float dx = x - xs[j];
+        float dy = y - ys[j];
+        float distanceSquared = dx * dx + dy * dy;
+        float reach = radius + radii[j];
+
+        if (distanceSquared <= EPSILON || distanceSquared >= reach * reach) continue;
+
+        float distance = std::sqrt(distanceSquared);
+        float weight = (reach - distance) / (reach * distance);
+        forceX += dx * weight;
+        forceY += dy * weight;
+    }
+}
+}
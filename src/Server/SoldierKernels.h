@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// vectorised soldier movement, AVX2 or SSE depending on what the compiler targets with a scalar tail/fallback
+namespace SoldierKernels {
+// scales every non-zero (x, y) to unit length, zero vectors stay zero
+void normalize(float *x, float *y, std::size_t count);
+
+// x += vx * dt, y += vy * dt
+void integrate(float *x, float *y, const float *vx, const float *vy, float dt, std::size_t count);
+
+// adds the push away from count soldiers at (xs, ys) to force, for each one the soldier at (x, y) overlaps with,
+// scaled by how deep the overlap is (0 when touching, 1 when on top of each other)
+void separation(float x, float y, float radius, const float *xs, const float *ys, const float *radii,
+                std::size_t count, float& forceX, float& forceY);
+
+// name of the instruction set the kernels were compiled for
+const char *instructionSet();
+}
@@ -0,0 +1,52 @@
+#include "SpatialGrid.h"
+
+// keeps a few far away points from blowing up the cell array
+constexpr std::size_t MAX_CELLS = 1 << 20;
+
+void SpatialGrid::build(const float *x, const float *y, std::size_t count) {
+    m_Indices.resize(count);
+    m_PointCells.resize(count);
+    if (count == 0) return;
+
+    float maxX = x[0];
+    float maxY = y[0];
+    m_MinX = x[0];
+    m_MinY = y[0];
+    for (std::size_t i = 1; i < count; i++) {
+        m_MinX = std::min(m_MinX, x[i]);
+        m_MinY = std::min(m_MinY, y[i]);
+        maxX = std::max(maxX, x[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+
+    m_ActiveCellSize = m_CellSize;
+    while (true) {
+        m_Columns = static_cast<int>((maxX - m_MinX) / m_ActiveCellSize) + 1;
+        m_Rows = static_cast<int>((maxY - m_MinY) / m_ActiveCellSize) + 1;
+        if (static_cast<std::size_t>(m_Columns) * m_Rows <= MAX_CELLS) break;
+        m_ActiveCellSize *= 2.f;
+    }
+
+    std::size_t cells = static_cast<std::size_t>(m_Columns) * m_Rows;
+    m_CellStart.assign(cells + 1, 0);
+
+    for (std::size_t i = 0; i < count; i++) {
+        uint32_t cell = static_cast<uint32_t>(cellRow(y[i]) * m_Columns + cellColumn(x[i]));
+        m_PointCells[i] = cell;
+        m_CellStart[cell + 1]++;
+    }
+
+    for (std::size_t cell = 0; cell < cells; cell++) {
+        m_CellStart[cell + 1] += m_CellStart[cell];
+    }
+
+    // m_CellStart[cell] is used as the write cursor and ends up at the start of the next cell
+    for (std::size_t i = 0; i < count; i++) {
+        m_Indices[m_CellStart[m_PointCells[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    for (std::size_t cell = cells; cell > 0; cell--) {
+        m_CellStart[cell] = m_CellStart[cell - 1];
+    }
+    m_CellStart[0] = 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// uniform grid over a set of points, rebuilt from scratch every tick with a counting sort
+class SpatialGrid {
+public:
+    explicit SpatialGrid(float cellSize) : m_CellSize(cellSize), m_ActiveCellSize(cellSize) {}
+
+    void build(const float *x, const float *y, std::size_t count);
+
+    // calls function(index) for every point in a cell touched by the square around (x, y)
+    template<typename F>
+    void query(float x, float y, float range, F&& function) const {
+        if (m_Indices.empty()) return;
+
+        int minColumn = cellColumn(x - range);
+        int maxColumn = cellColumn(x + range);
+        int minRow = cellRow(y - range);
+        int maxRow = cellRow(y + range);
+
+        for (int row = minRow; row <= maxRow; row++) {
+            for (int column = minColumn; column <= maxColumn; column++) {
+                std::size_t cell = static_cast<std::size_t>(row) * m_Columns + column;
+                for (uint32_t i = m_CellStart[cell]; i < m_CellStart[cell + 1]; i++) {
+                    function(static_cast<std::size_t>(m_Indices[i]));
+                }
+            }
+        }
+    }
+
+private:
+    [[nodiscard]] int cellColumn(float x) const {
+        return std::clamp(static_cast<int>(std::floor((x - m_MinX) / m_ActiveCellSize)), 0, m_Columns - 1);
+    }
+
+    [[nodiscard]] int cellRow(float y) const {
+        return std::clamp(static_cast<int>(std::floor((y - m_MinY) / m_ActiveCellSize)), 0, m_Rows - 1);
+    }
+
+    float m_CellSize;
+    // bigger than m_CellSize when the points are spread too far apart
+    float m_ActiveCellSize;
+    float m_MinX = 0.f;
+    float m_MinY = 0.f;
+    int m_Columns = 0;
+    int m_Rows = 0;
+
+    std::vector<uint32_t> m_CellStart;
+    std::vector<uint32_t> m_Indices;
+    std::vector<uint32_t> m_PointCells;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "SFML/Network/Packet.hpp"
+
+// pixels per second
+struct Velocity {
+    float x = 0.f;
+    float y = 0.f;
+};
+
+inline sf::Packet& operator<<(sf::Packet& packet, const Velocity& velocity) {
+    return packet << velocity.x << velocity.y;
+}
+
+inline sf::Packet& operator>>(sf::Packet& packet, Velocity& velocity) {
+    return packet >> velocity.x >> velocity.y;
+}
@@ -0,0 +1,241 @@
+#include "AssetPack.h"
+#include "logy.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LTK_ASSETS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr char PACK_MAGIC[4] = { 'L', 'T', 'K', 'A' };
+constexpr uint16_t PACK_VERSION = 1;
+// every asset starts on this boundary so decoders read aligned memory
+constexpr std::size_t PACK_ALIGNMENT = 16;
+
+struct Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t entryCount;
+    // bytes of index right after the header
+    uint32_t indexSize;
+};
+
+// followed by nameLength bytes of name, entries are packed back to back
+struct IndexEntry {
+    uint64_t offset;
+    uint64_t size;
+    uint16_t nameLength;
+};
+
+constexpr std::size_t INDEX_ENTRY_SIZE = sizeof(uint64_t) * 2 + sizeof(uint16_t);
+
+template<typename T>
+void append(std::vector<char>& out, const T& value) {
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+bool readFile(const std::filesystem::path& path, std::vector<char>& out) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+
+    out.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    return static_cast<bool>(file.read(out.data(), static_cast<std::streamsize>(out.size())));
+}
+}
+
+namespace Utils {
+AssetPack::~AssetPack() {
+    close();
+}
+
+bool AssetPack::open(const std::string& path) {
+    close();
+
+#if LTK_ASSETS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info{};
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            m_Data = static_cast<const char *>(mapping);
+            m_Size = info.st_size;
+            m_Mapped = true;
+        }
+    }
+    ::close(fd);
+#else
+    if (readFile(path, m_Buffer)) {
+        m_Data = m_Buffer.data();
+        m_Size = m_Buffer.size();
+    }
+#endif
+
+    if (!m_Data) return false;
+    if (!parse()) {
+        LOG_WARNING("Asset pack", path, "is damaged or from another version");
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool AssetPack::openDirectory(const std::filesystem::path& directory) {
+    close();
+
+    if (!build(directory, m_Buffer)) return false;
+    m_Data = m_Buffer.data();
+    m_Size = m_Buffer.size();
+    return parse();
+}
+
+void AssetPack::close() {
+#if LTK_ASSETS_MMAP
+    if (m_Mapped) ::munmap(const_cast<char *>(m_Data), m_Size);
+#endif
+
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Mapped = false;
+    m_Buffer.clear();
+    m_Buffer.shrink_to_fit();
+    m_Entries.clear();
+}
+
+std::span<const char> AssetPack::get(const std::string& name) const {
+    auto it = m_Entries.find(name);
+    if (it == m_Entries.end()) return {};
+    return it->second;
+}
+
+bool AssetPack::parse() {
+    Header header{};
+    if (m_Size < sizeof(Header)) return false;
+    std::memcpy(&header, m_Data, sizeof(Header));
+
+    if (std::memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) return false;
+    if (header.version != PACK_VERSION) return false;
+    if (header.indexSize > m_Size - sizeof(Header)) return false;
+
+    const char *cursor = m_Data + sizeof(Header);
+    const char *end = cursor + header.indexSize;
+
+    m_Entries.reserve(header.entryCount);
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        if (static_cast<std::size_t>(end - cursor) < INDEX_ENTRY_SIZE) return false;
+
+        IndexEntry entry{};
+        std::memcpy(&entry.offset, cursor, sizeof(entry.offset));
+        std::memcpy(&entry.size, cursor + sizeof(uint64_t), sizeof(entry.size));
+        std::memcpy(&entry.nameLength, cursor + sizeof(uint64_t) * 2, sizeof(entry.nameLength));
+        cursor += INDEX_ENTRY_SIZE;
+
+        if (static_cast<std::size_t>(end - cursor) < entry.nameLength) return false;
+        std::string name(cursor, entry.nameLength);
+        cursor += entry.nameLength;
+
+        if (entry.offset > m_Size || entry.size > m_Size - entry.offset) return false;
+        m_Entries.emplace(std::move(name), std::span<const char>(m_Data + entry.offset, entry.size));
+    }
+
+    return true;
+}
+
+bool AssetPack::build(const std::filesystem::path& directory, std::vector<char>& out) {
+    std::error_code error;
+    std::vector<std::filesystem::path> files;
+    for (const auto& item: std::filesystem::directory_iterator(directory, error)) {
+        if (item.is_regular_file()) files.push_back(item.path());
+    }
+    if (error) {
+        LOG_WARNING("Failed to list assets in", directory.string(), error.message());
+        return false;
+    }
+
+    // sorted so the same assets always produce the same pack
+    std::sort(files.begin(), files.end());
+
+    std::vector<std::vector<char>> contents(files.size());
+    uint32_t indexSize = 0;
+    for (std::size_t i = 0; i < files.size(); i++) {
+        if (!readFile(files[i], contents[i])) {
+            LOG_WARNING("Failed to read asset", files[i].string());
+            return false;
+        }
+        std::size_t nameLength = files[i].filename().string().size();
+        if (nameLength > UINT16_MAX) {
+            LOG_WARNING("Asset name too long", files[i].string());
+            return false;
+        }
+        indexSize += INDEX_ENTRY_SIZE + nameLength;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = PACK_VERSION;
+    header.entryCount = static_cast<uint32_t>(files.size());
+    header.indexSize = indexSize;
+
+    out.clear();
+    append(out, header);
+
+    uint64_t offset = sizeof(Header) + indexSize;
+    std::vector<uint64_t> offsets(files.size());
+    for (std::size_t i = 0; i < files.size(); i++) {
+        offset = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+        offsets[i] = offset;
+
+        std::string name = files[i].filename().string();
+        IndexEntry entry{ offset, contents[i].size(), static_cast<uint16_t>(name.size()) };
+        append(out, entry.offset);
+        append(out, entry.size);
+        append(out, entry.nameLength);
+        out.insert(out.end(), name.begin(), name.end());
+
+        offset += contents[i].size();
+    }
+
+    for (std::size_t i = 0; i < files.size(); i++) {
+        out.resize(offsets[i], 0);
+        out.insert(out.end(), contents[i].begin(), contents[i].end());
+    }
+
+    return true;
+}
+
+bool AssetPack::write(const std::string& path, const std::filesystem::path& directory) {
+    std::vector<char> pack;
+    if (!build(directory, pack)) return false;
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(pack.data(), static_cast<std::streamsize>(pack.size()));
+        if (!file) {
+            LOG_WARNING("Failed to write asset pack", temporary);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        LOG_WARNING("Failed to write asset pack", path, error.message());
+        return false;
+    }
+
+    return true;
+}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Utils {
+// every asset in one read only file, an index of names followed by the data. the PackAssets tool writes it at
+// build time, at startup it is mapped into memory and an asset is just a pointer into the mapping
+class AssetPack {
+public:
+    AssetPack() = default;
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // what get() returns stays valid until the pack is closed
+    bool open(const std::string& path);
+    // packs the files in memory instead, for running from the source tree without a built pack
+    bool openDirectory(const std::filesystem::path& directory);
+    void close();
+
+    // empty when there's no such asset
+    [[nodiscard]] std::span<const char> get(const std::string& name) const;
+    [[nodiscard]] std::size_t size() const { return m_Entries.size(); }
+
+    // every file directly in the directory, named after the file, subdirectories are left out
+    static bool build(const std::filesystem::path& directory, std::vector<char>& out);
+    // written through a temporary file so a failed build never leaves half a pack behind
+    static bool write(const std::string& path, const std::filesystem::path& directory);
+
+private:
+    bool parse();
+
+    const char *m_Data = nullptr;
+    std::size_t m_Size = 0;
+    bool m_Mapped = false;
+    // the whole pack when it isn't mapped
+    std::vector<char> m_Buffer;
+
+    std::unordered_map<std::string, std::span<const char>> m_Entries;
+};
+}
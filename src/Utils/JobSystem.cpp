@@ -0,0 +1,122 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace Utils {
+JobSystem::JobSystem(std::size_t threadCount) {
+    m_Workers.reserve(threadCount + 1);
+    for (std::size_t i = 0; i < threadCount + 1; i++) {
+        m_Workers.push_back(std::make_unique<Worker>());
+    }
+
+    // worker 0 is whoever calls parallelFor
+    for (std::size_t i = 1; i < m_Workers.size(); i++) {
+        m_Workers[i]->thread = std::thread(&JobSystem::workerThread, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard guard(m_SleepMutex);
+        m_Running = false;
+    }
+    m_SleepCondition.notify_all();
+
+    for (auto& worker: m_Workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+std::size_t JobSystem::defaultThreadCount() {
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+void JobSystem::parallelFor(std::size_t count, std::size_t chunkSize, const RangeFunction& function) {
+    if (count == 0) return;
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+
+    if (count <= chunkSize || m_Workers.size() == 1) {
+        function(0, count, 0);
+        return;
+    }
+
+    std::size_t chunks = (count + chunkSize - 1) / chunkSize;
+    std::atomic<std::size_t> remaining = chunks;
+
+    {
+        std::lock_guard guard(m_SleepMutex);
+        m_QueuedJobs += chunks;
+    }
+
+    for (std::size_t chunk = 0; chunk < chunks; chunk++) {
+        std::size_t begin = chunk * chunkSize;
+        std::size_t end = std::min(begin + chunkSize, count);
+
+        Worker& worker = *m_Workers[chunk % m_Workers.size()];
+        std::lock_guard guard(worker.mutex);
+        worker.jobs.emplace_back([&function, &remaining, begin, end](std::size_t workerIndex) {
+            function(begin, end, workerIndex);
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        });
+    }
+
+    m_SleepCondition.notify_all();
+
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!runOne(0)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerThread(std::size_t index) {
+    Profiler::setThreadName("job worker " + std::to_string(index));
+
+    while (true) {
+        if (runOne(index)) continue;
+
+        std::unique_lock lock(m_SleepMutex);
+        m_SleepCondition.wait(lock, [this] { return !m_Running || m_QueuedJobs > 0; });
+        if (!m_Running) return;
+    }
+}
+
+bool JobSystem::runOne(std::size_t index) {
+    Job job;
+    if (!pop(index, job) && !steal(index, job)) {
+        return false;
+    }
+
+    m_QueuedJobs--;
+    job(index);
+    return true;
+}
+
+bool JobSystem::pop(std::size_t index, Job& job) {
+    Worker& worker = *m_Workers[index];
+    std::lock_guard guard(worker.mutex);
+    if (worker.jobs.empty()) return false;
+
+    job = std::move(worker.jobs.back());
+    worker.jobs.pop_back();
+    return true;
+}
+
+bool JobSystem::steal(std::size_t index, Job& job) {
+    for (std::size_t offset = 1; offset < m_Workers.size(); offset++) {
+        Worker& victim = *m_Workers[(index + offset) % m_Workers.size()];
+        std::lock_guard guard(victim.mutex);
+        if (victim.jobs.empty()) continue;
+
+        job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        return true;
+    }
+
+    return false;
+}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Utils {
+// small work-stealing scheduler, every worker owns a deque and steals from the others when it runs dry.
+// the thread calling parallelFor takes part as worker 0, so workerCount() is threads + 1
+class JobSystem {
+public:
+    // begin, end, worker index
+    using RangeFunction = std::function<void(std::size_t, std::size_t, std::size_t)>;
+
+    explicit JobSystem(std::size_t threadCount = defaultThreadCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    [[nodiscard]] std::size_t workerCount() const { return m_Workers.size(); }
+
+    // splits [0, count) into chunks of chunkSize and blocks until all of them ran
+    void parallelFor(std::size_t count, std::size_t chunkSize, const RangeFunction& function);
+
+    static std::size_t defaultThreadCount();
+
+private:
+    using Job = std::function<void(std::size_t)>;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        std::thread thread;
+    };
+
+    void workerThread(std::size_t index);
+
+    bool pop(std::size_t index, Job& job);
+    bool steal(std::size_t index, Job& job);
+    bool runOne(std::size_t index);
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+
+    std::mutex m_SleepMutex;
+    std::condition_variable m_SleepCondition;
+    std::atomic<std::size_t> m_QueuedJobs = 0;
+    std::atomic<bool> m_Running = true;
+};
+}
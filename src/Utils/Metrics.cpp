@@ -0,0 +1,280 @@
+#include "Metrics.h"
+#include "logy.h"
+#include "SFML/Network/SocketSelector.hpp"
+#include "SFML/Network/TcpListener.hpp"
+#include "SFML/Network/TcpSocket.hpp"
+#include "SFML/System/Sleep.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+enum class MetricType {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM,
+};
+
+struct Series {
+    std::string labels;
+    std::unique_ptr<Utils::Metrics::Counter> counter{};
+    std::unique_ptr<Utils::Metrics::Gauge> gauge{};
+    std::unique_ptr<Utils::Metrics::Histogram> histogram{};
+};
+
+struct Family {
+    std::string help;
+    MetricType type;
+    std::vector<Series> series;
+};
+
+std::mutex s_Mutex;
+// ordered so the output is stable between scrapes
+std::map<std::string, Family> s_Families;
+
+std::string formatLabels(Utils::Metrics::Labels labels) {
+    std::string out;
+    for (const auto& [key, value]: labels) {
+        if (!out.empty()) out += ',';
+        out += key;
+        out += "=\"";
+        for (char c: value) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') {
+                out += "\\n";
+                continue;
+            }
+            out += c;
+        }
+        out += '"';
+    }
+    return out;
+}
+
+Series& series(const std::string& name, const std::string& help, MetricType type,
+               Utils::Metrics::Labels labels) {
+    auto [it, created] = s_Families.try_emplace(name, Family{ help, type, {} });
+    if (!created && it->second.type != type) {
+        throw std::runtime_error("Error: metric '" + name + "' registered again with a different type");
+    }
+
+    std::string formatted = formatLabels(labels);
+    for (auto& existing: it->second.series) {
+        if (existing.labels == formatted) return existing;
+    }
+
+    it->second.series.push_back(Series{ .labels = std::move(formatted) });
+    return it->second.series.back();
+}
+
+void appendNumber(std::string& out, double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.10g", value);
+    out += buffer;
+}
+
+void appendSample(std::string& out, const std::string& name, const std::string& labels, double value) {
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    appendNumber(out, value);
+    out += '\n';
+}
+}
+
+namespace Utils::Metrics {
+Histogram::Histogram(std::vector<double> bounds)
+        : m_Bounds(std::move(bounds)), m_Buckets(new std::atomic<uint64_t>[m_Bounds.size() + 1]) {
+    for (std::size_t i = 0; i <= m_Bounds.size(); i++) m_Buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void Histogram::observe(double value) {
+    std::size_t index = 0;
+    while (index < m_Bounds.size() && value > m_Bounds[index]) index++;
+
+    m_Buckets[index].fetch_add(1, std::memory_order_relaxed);
+    m_Sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+Counter& counter(const std::string& name, const std::string& help, Labels labels) {
+    std::lock_guard guard(s_Mutex);
+    Series& found = series(name, help, MetricType::COUNTER, labels);
+    if (!found.counter) found.counter = std::make_unique<Counter>();
+    return *found.counter;
+}
+
+Gauge& gauge(const std::string& name, const std::string& help, Labels labels) {
+    std::lock_guard guard(s_Mutex);
+    Series& found = series(name, help, MetricType::GAUGE, labels);
+    if (!found.gauge) found.gauge = std::make_unique<Gauge>();
+    return *found.gauge;
+}
+
+Histogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds, Labels labels) {
+    std::lock_guard guard(s_Mutex);
+    Series& found = series(name, help, MetricType::HISTOGRAM, labels);
+    if (!found.histogram) found.histogram = std::make_unique<Histogram>(std::move(bounds));
+    return *found.histogram;
+}
+
+std::string render() {
+    std::lock_guard guard(s_Mutex);
+
+    std::string out;
+    for (const auto& [name, family]: s_Families) {
+        out += "# HELP " + name + ' ' + family.help + '\n';
+        switch (family.type) {
+            case MetricType::COUNTER:
+                out += "# TYPE " + name + " counter\n";
+                for (const auto& s: family.series) appendSample(out, name, s.labels, s.counter->value());
+                break;
+            case MetricType::GAUGE:
+                out += "# TYPE " + name + " gauge\n";
+                for (const auto& s: family.series) appendSample(out, name, s.labels, s.gauge->value());
+                break;
+            case MetricType::HISTOGRAM: {
+                out += "# TYPE " + name + " histogram\n";
+                for (const auto& s: family.series) {
+                    const Histogram& histogram = *s.histogram;
+                    std::string prefix = s.labels.empty() ? "" : s.labels + ',';
+
+                    uint64_t cumulative = 0;
+                    for (std::size_t i = 0; i <= histogram.bounds().size(); i++) {
+                        cumulative += histogram.bucket(i);
+
+                        std::string bound = "+Inf";
+                        if (i < histogram.bounds().size()) {
+                            bound.clear();
+                            appendNumber(bound, histogram.bounds()[i]);
+                        }
+                        appendSample(out, name + "_bucket", prefix + "le=\"" + bound + '"',
+                                     static_cast<double>(cumulative));
+                    }
+
+                    appendSample(out, name + "_sum", s.labels, histogram.sum());
+                    appendSample(out, name + "_count", s.labels, static_cast<double>(cumulative));
+                }
+                break;
+            }
+        }
+    }
+
+    return out;
+}
+
+Exporter::~Exporter() {
+    stop();
+}
+
+bool Exporter::serve(uint16_t port) {
+    stop();
+
+    m_Running = true;
+    m_Listening = false;
+    m_Failed = false;
+    m_Thread = std::thread(&Exporter::serveThread, this, port);
+
+    while (!m_Listening && !m_Failed) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    if (m_Failed) {
+        stop();
+        LOG_WARNING("Failed to serve metrics on port", port);
+        return false;
+    }
+
+    LOG_INFO("Serving metrics on localhost port", port);
+    return true;
+}
+
+void Exporter::writeFile(const std::string& path, double intervalSeconds) {
+    stop();
+
+    m_Running = true;
+    m_Thread = std::thread(&Exporter::fileThread, this, path, intervalSeconds);
+    LOG_INFO("Writing metrics to", path);
+}
+
+void Exporter::stop() {
+    m_Running = false;
+    if (m_Thread.joinable()) m_Thread.join();
+}
+
+void Exporter::serveThread(uint16_t port) {
+    sf::TcpListener listener;
+    if (listener.listen(port, sf::IpAddress::LocalHost) != sf::Socket::Status::Done) {
+        m_Failed = true;
+        return;
+    }
+
+    listener.setBlocking(false);
+    m_Listening = true;
+
+    while (m_Running) {
+        sf::TcpSocket socket;
+        if (listener.accept(socket) != sf::Socket::Status::Done) {
+            sf::sleep(sf::milliseconds(50));
+            continue;
+        }
+
+        // whatever was asked for, every request gets the metrics
+        sf::SocketSelector selector;
+        selector.add(socket);
+        if (selector.wait(sf::seconds(1))) {
+            char request[1024];
+            std::size_t received;
+            socket.receive(request, sizeof(request), received);
+        }
+
+        std::string body = render();
+        std::string response = "HTTP/1.0 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n\r\n" + body;
+
+        socket.setBlocking(true);
+        if (socket.send(response.data(), response.size()) != sf::Socket::Status::Done) {
+            LOG_WARNING("Failed to send metrics");
+        }
+        socket.disconnect();
+    }
+
+    listener.close();
+}
+
+void Exporter::fileThread(std::string path, double intervalSeconds) {
+    auto interval = std::chrono::duration<double>(std::max(intervalSeconds, 0.1));
+    auto next = std::chrono::steady_clock::now();
+
+    while (m_Running) {
+        if (std::chrono::steady_clock::now() < next) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::trunc);
+            file << render();
+            if (!file) {
+                LOG_WARNING("Failed to write metrics to", temporary);
+                continue;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (error) LOG_WARNING("Failed to write metrics to", path, error.message());
+    }
+}
+}
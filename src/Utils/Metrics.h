@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// process wide metrics in the prometheus text format. metrics are registered once, usually at startup,
+// and the references handed out stay valid for the rest of the process, updating them is a relaxed atomic add
+namespace Utils::Metrics {
+using Labels = std::initializer_list<std::pair<const char *, std::string>>;
+
+class Counter {
+public:
+    void add(double value = 1.0) { m_Value.fetch_add(value, std::memory_order_relaxed); }
+    [[nodiscard]] double value() const { return m_Value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> m_Value = 0.0;
+};
+
+class Gauge {
+public:
+    void set(double value) { m_Value.store(value, std::memory_order_relaxed); }
+    void add(double value) { m_Value.fetch_add(value, std::memory_order_relaxed); }
+    [[nodiscard]] double value() const { return m_Value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> m_Value = 0.0;
+};
+
+class Histogram {
+public:
+    // upper bounds in increasing order, +Inf is implied
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double value);
+
+    [[nodiscard]] const std::vector<double>& bounds() const { return m_Bounds; }
+    // not cumulative, the last one counts everything above the highest bound
+    [[nodiscard]] uint64_t bucket(std::size_t index) const { return m_Buckets[index].load(std::memory_order_relaxed); }
+    [[nodiscard]] double sum() const { return m_Sum.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<double> m_Bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_Buckets;
+    std::atomic<double> m_Sum = 0.0;
+};
+
+// registering the same name and labels again returns the metric that's already there
+Counter& counter(const std::string& name, const std::string& help, Labels labels = {});
+Gauge& gauge(const std::string& name, const std::string& help, Labels labels = {});
+Histogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds,
+                     Labels labels = {});
+
+// everything registered, in the prometheus text exposition format
+std::string render();
+
+// serves render() over http on its own thread, or keeps rewriting a file with it. one or the other per exporter,
+// starting either stops whatever the exporter was doing
+class Exporter {
+public:
+    Exporter() = default;
+    ~Exporter();
+
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+
+    // only listens on localhost, anything reachable from outside should sit behind a proxy
+    bool serve(uint16_t port);
+    // written through a temporary file so readers never see half of it
+    void writeFile(const std::string& path, double intervalSeconds);
+
+    void stop();
+
+private:
+    void serveThread(uint16_t port);
+    void fileThread(std::string path, double intervalSeconds);
+
+    std::atomic<bool> m_Running = false;
+    std::atomic<bool> m_Listening = false;
+    std::atomic<bool> m_Failed = false;
+    std::thread m_Thread;
+};
+}
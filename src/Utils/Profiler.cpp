@@ -0,0 +1,141 @@
+#include "Profiler.h"
+#include "logy.h"
+
+#include <algorithm>
+#include <array>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+// about a second of zones at a few thousand per frame
+constexpr std::size_t RING_SIZE = 1 << 16;
+
+struct Event {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// written only by its own thread, the dump reads it from the outside
+struct ThreadBuffer {
+    std::array<Event, RING_SIZE> events;
+    std::atomic<uint64_t> head = 0;
+    uint32_t id = 0;
+    std::string name;
+};
+
+std::mutex s_BuffersMutex;
+// kept alive after their thread exits so its zones still end up in the dump
+std::vector<std::shared_ptr<ThreadBuffer>> s_Buffers;
+
+std::atomic<bool> s_DumpRequested = false;
+
+ThreadBuffer& threadBuffer() {
+    thread_local ThreadBuffer *buffer = [] {
+        auto created = std::make_shared<ThreadBuffer>();
+
+        std::lock_guard guard(s_BuffersMutex);
+        created->id = static_cast<uint32_t>(s_Buffers.size());
+        created->name = "thread " + std::to_string(created->id);
+        s_Buffers.push_back(created);
+        return created.get();
+    }();
+
+    return *buffer;
+}
+
+void onSignal(int) {
+    s_DumpRequested.store(true, std::memory_order_relaxed);
+}
+
+void writeEscaped(std::FILE *file, const std::string& text) {
+    for (char c: text) {
+        if (c == '"' || c == '\\') std::fputc('\\', file);
+        std::fputc(c, file);
+    }
+}
+}
+
+namespace Utils::Profiler {
+void record(const char *name, uint64_t start, uint64_t end) {
+    ThreadBuffer& buffer = threadBuffer();
+
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % RING_SIZE] = Event{ name, start, end };
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void setThreadName(const std::string& name) {
+    ThreadBuffer& buffer = threadBuffer();
+
+    std::lock_guard guard(s_BuffersMutex);
+    buffer.name = name;
+}
+
+void installSignalHandler() {
+    std::signal(SIGUSR1, onSignal);
+}
+
+void requestDump() {
+    s_DumpRequested.store(true, std::memory_order_relaxed);
+}
+
+void pollDump() {
+    if (!s_DumpRequested.exchange(false, std::memory_order_relaxed)) return;
+
+    std::string path = "trace-" + std::to_string(std::time(nullptr)) + ".json";
+    if (dump(path)) LOG_INFO("Wrote profiler trace to", path);
+    else LOG_WARNING("Failed to write profiler trace to", path);
+}
+
+bool dump(const std::string& path) {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard guard(s_BuffersMutex);
+        buffers = s_Buffers;
+    }
+
+    std::FILE *file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+
+    std::vector<Event> events;
+    for (const auto& buffer: buffers) {
+        {
+            std::lock_guard guard(s_BuffersMutex);
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                         first ? "" : ",\n", buffer->id);
+            writeEscaped(file, buffer->name);
+            std::fprintf(file, "\"}}");
+            first = false;
+        }
+
+        // the owner keeps writing while we copy, anything it may have lapped in the meantime is thrown away
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > RING_SIZE ? head - RING_SIZE : 0;
+
+        events.clear();
+        for (uint64_t i = begin; i < head; i++) events.push_back(buffer->events[i % RING_SIZE]);
+
+        uint64_t headAfter = buffer->head.load(std::memory_order_acquire);
+        uint64_t valid = headAfter > RING_SIZE ? headAfter - RING_SIZE : 0;
+        std::size_t skip = static_cast<std::size_t>(std::min<uint64_t>(valid > begin ? valid - begin : 0,
+                                                                         events.size()));
+
+        for (std::size_t i = skip; i < events.size(); i++) {
+            const Event& event = events[i];
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         event.name, buffer->id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+        }
+    }
+
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "opts.h"
+
+// scoped timing zones recorded into a ring buffer per thread and dumped as a chrome trace,
+// open the file in chrome://tracing or ui.perfetto.dev
+namespace Utils::Profiler {
+inline std::atomic<bool> s_Enabled = false;
+
+inline uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+// name has to outlive the profiler, zones are always given string literals
+void record(const char *name, uint64_t start, uint64_t end);
+
+inline void setEnabled(bool enabled) { s_Enabled.store(enabled, std::memory_order_relaxed); }
+inline bool enabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+// shows up as the thread's name in the trace
+void setThreadName(const std::string& name);
+
+// SIGUSR1 asks for a dump, it's written the next time the main loop polls
+void installSignalHandler();
+void requestDump();
+// writes trace-<time>.json if a dump was requested
+void pollDump();
+
+// the last zones of every thread, false if the file couldn't be written
+bool dump(const std::string& path);
+
+class Scope {
+public:
+    // a disabled zone costs one relaxed load and a branch on each end
+    explicit Scope(const char *name) : m_Name(name), m_Start(enabled() ? now() : 0) {}
+
+    ~Scope() {
+        if (m_Start) record(m_Name, m_Start, now());
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char *m_Name;
+    uint64_t m_Start;
+};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if LTK_PROFILE
+#define PROFILE_SCOPE(name) Utils::Profiler::Scope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void) 0)
+#endif
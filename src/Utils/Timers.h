@@ -43,4 +43,20 @@ private:
     double m_TimeStep;
     double m_Count = 0.0;
 };
+
+// milliseconds between laps, for timing the parts of a tick
+class Stopwatch {
+public:
+    Stopwatch() : m_Last{ std::chrono::steady_clock::now() } {}
+
+    double lap() {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - m_Last).count();
+        m_Last = now;
+        return ms;
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_Last;
+};
 }
\ No newline at end of file
@@ -1,20 +1,112 @@
+#include <cctype>
+#include <charconv>
+#include <cstdio>
 #include <cstring>
+#include <initializer_list>
+#include <string>
 #include "Server/Server.h"
+#include "Server/ServerBench.h"
 #include "Client/Client.h"
+#include "Client/RenderBench.h"
 #include "Packets.h"
+#include "Utils/Profiler.h"
+
+namespace {
+// the whole argument as a number no larger than max, std::stoul would throw on a typo
+bool parseNumber(const char *text, uint32_t max, uint32_t& value) {
+    const char *end = text + strlen(text);
+    uint32_t parsed = 0;
+    auto [ptr, error] = std::from_chars(text, end, parsed);
+    if (error != std::errc() || ptr != end || parsed > max) return false;
+
+    value = parsed;
+    return true;
+}
+
+// the optional numbers after the mode, in order, leaving the defaults of those not given
+bool parseArguments(int argc, char *argv[], std::initializer_list<uint32_t *> values) {
+    if (argc - 2 > static_cast<int>(values.size())) return false;
+
+    int i = 2;
+    for (uint32_t *value: values) {
+        if (i >= argc) break;
+        if (!parseNumber(argv[i++], UINT32_MAX, *value)) return false;
+    }
+    return true;
+}
+}
 
 int main(int argc, char *argv[]) {
     registerPackets();
+    // SIGUSR1 writes a profiler trace
+    Utils::Profiler::installSignalHandler();
 
     constexpr uint16_t PORT = 6969;
     const sf::IpAddress IP = sf::IpAddress::getLocalAddress().value_or(sf::IpAddress::LocalHost);
 
     if (argc > 1) {
         if (strcmp(argv[1], "server") == 0) {
-            Server server(IP, PORT);
+            // server [lockstep] [profile] [journal <path>] [checkpoint <path> [ticks between checkpoints]]
+            //        [metrics <port>] [metrics-file <path>]
+            bool lockstep = false;
+            const char *journal = nullptr;
+            const char *checkpoint = nullptr;
+            uint32_t checkpointInterval = 20 * 10;
+            uint32_t metricsPort = 0;
+            const char *metricsFile = nullptr;
+            for (int i = 2; i < argc; i++) {
+                if (strcmp(argv[i], "lockstep") == 0) lockstep = true;
+                else if (strcmp(argv[i], "profile") == 0) Utils::Profiler::setEnabled(true);
+                else if (strcmp(argv[i], "journal") == 0 && i + 1 < argc) journal = argv[++i];
+                else if (strcmp(argv[i], "checkpoint") == 0 && i + 1 < argc) {
+                    checkpoint = argv[++i];
+                    if (i + 1 < argc && isdigit(argv[i + 1][0]) && !parseNumber(argv[++i], UINT32_MAX, checkpointInterval)) {
+                        std::fprintf(stderr, "ticks between checkpoints must be a number, got %s\n", argv[i]);
+                        return 1;
+                    }
+                }
+                else if (strcmp(argv[i], "metrics") == 0 && i + 1 < argc) {
+                    if (!parseNumber(argv[++i], UINT16_MAX, metricsPort) || metricsPort == 0) {
+                        std::fprintf(stderr, "metrics port must be between 1 and 65535, got %s\n", argv[i]);
+                        return 1;
+                    }
+                }
+                else if (strcmp(argv[i], "metrics-file") == 0 && i + 1 < argc) metricsFile = argv[++i];
+            }
+
+            Utils::Profiler::setThreadName("server tick");
+
+            Server server(IP, PORT, lockstep);
+            if (journal) server.openJournal(journal);
+            if (checkpoint) server.enableCheckpoints(checkpoint, checkpointInterval);
+            if (metricsPort) server.serveMetrics(static_cast<uint16_t>(metricsPort));
+            if (metricsFile) server.writeMetrics(metricsFile);
             server.start();
             server.run();
+        } else if (strcmp(argv[1], "replay") == 0 && argc > 2) {
+            Server server(sf::IpAddress::LocalHost, PORT);
+            return server.replay(argv[2]) ? 0 : 1;
+        } else if (strcmp(argv[1], "server-bench") == 0) {
+            // server-bench [players] [structures per player] [soldiers per player] [ticks]
+            ServerBench::Config config;
+            if (!parseArguments(argc, argv, { &config.players, &config.structures, &config.soldiers, &config.ticks })) {
+                std::fprintf(stderr, "usage: server-bench [players] [structures per player] [soldiers per player] [ticks]\n");
+                return 1;
+            }
+
+            return ServerBench(config).run() ? 0 : 1;
+        } else if (strcmp(argv[1], "render-bench") == 0) {
+            // render-bench [structures] [walls] [soldiers] [frames], renders offscreen with software OpenGL
+            RenderBench::Config config;
+            if (!parseArguments(argc, argv, { &config.structures, &config.walls, &config.soldiers, &config.frames })) {
+                std::fprintf(stderr, "usage: render-bench [structures] [walls] [soldiers] [frames]\n");
+                return 1;
+            }
+
+            return RenderBench(config).run() ? 0 : 1;
         } else if (strcmp(argv[1], "client") == 0) {
+            Utils::Profiler::setThreadName("client main");
+
             Client client(IP, PORT, argv[2]);
             client.start();
             client.run();
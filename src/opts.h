@@ -1,3 +1,6 @@
 #pragma once
 
 #define LTK_DEBUG 1
+
+// compiles PROFILE_SCOPE zones in, they still only record once the profiler is enabled at runtime
+#define LTK_PROFILE 1
@@ -0,0 +1,15 @@
+#include "Utils/AssetPack.h"
+#include "logy.h"
+
+// PackAssets <pack> <directory>, packs every file directly in the directory
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        LOG_WARNING("Usage: PackAssets <pack> <directory>");
+        return 1;
+    }
+
+    if (!Utils::AssetPack::write(argv[1], argv[2])) return 1;
+
+    LOG_INFO("Packed", argv[2], "into", argv[1]);
+    return 0;
+}